@@ -0,0 +1,245 @@
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_tracker.hpp"
+#include "profiler.hpp"
+
+
+//-------------------------------------------------------
+//	counting
+//-------------------------------------------------------
+
+namespace
+{
+	using allocations::SUBSYSTEM_COUNT;
+
+	// everything here is constant initialized, allocations made during
+	// static initialization of other files are counted too
+	struct AtomicStats
+	{
+		std::atomic< int64_t > allocationCount;
+		std::atomic< int64_t > allocatedBytes;
+		std::atomic< int64_t > freeCount;
+	};
+
+	AtomicStats currentFrame[ SUBSYSTEM_COUNT ];
+	AtomicStats total[ SUBSYSTEM_COUNT ];
+	std::atomic< int64_t > steadyStateViolationCount( 0 );
+
+	thread_local allocations::Subsystem currentSubsystem = allocations::SUBSYSTEM_OTHER;
+	thread_local int armedSteadyStateDepth = 0;
+
+	// main thread only
+	allocations::Stats lastFrame[ SUBSYSTEM_COUNT ];
+
+
+	void countAllocation( size_t size )
+	{
+		AtomicStats &stats = currentFrame[ currentSubsystem ];
+		stats.allocationCount.fetch_add( 1, std::memory_order_relaxed );
+		stats.allocatedBytes.fetch_add( ( int64_t )size, std::memory_order_relaxed );
+		if ( armedSteadyStateDepth > 0 )
+		{
+			steadyStateViolationCount.fetch_add( 1, std::memory_order_relaxed );
+#ifdef WOTS_ALLOCATION_GUARD
+			// break here and look at the call stack to find who allocated
+			assert( !"allocation in steady state" );
+#endif
+		}
+	}
+
+
+	void countFree()
+	{
+		currentFrame[ currentSubsystem ].freeCount.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+
+	void *allocate( size_t size )
+	{
+		countAllocation( size );
+		return std::malloc( size ? size : 1 );
+	}
+
+
+	void release( void *pointer )
+	{
+		if ( !pointer )
+			return;
+		countFree();
+		std::free( pointer );
+	}
+
+
+	allocations::Stats load( AtomicStats const &stats )
+	{
+		return allocations::Stats{
+			stats.allocationCount.load( std::memory_order_relaxed ),
+			stats.allocatedBytes.load( std::memory_order_relaxed ),
+			stats.freeCount.load( std::memory_order_relaxed ) };
+	}
+}
+
+
+//-------------------------------------------------------
+//	global operators
+//-------------------------------------------------------
+
+void *operator new( size_t size )
+{
+	void *pointer = allocate( size );
+	if ( !pointer )
+		throw std::bad_alloc();
+	return pointer;
+}
+
+
+void *operator new[]( size_t size )
+{
+	void *pointer = allocate( size );
+	if ( !pointer )
+		throw std::bad_alloc();
+	return pointer;
+}
+
+
+void *operator new( size_t size, std::nothrow_t const & ) noexcept
+{
+	return allocate( size );
+}
+
+
+void *operator new[]( size_t size, std::nothrow_t const & ) noexcept
+{
+	return allocate( size );
+}
+
+
+void operator delete( void *pointer ) noexcept
+{
+	release( pointer );
+}
+
+
+void operator delete[]( void *pointer ) noexcept
+{
+	release( pointer );
+}
+
+
+void operator delete( void *pointer, size_t ) noexcept
+{
+	release( pointer );
+}
+
+
+void operator delete[]( void *pointer, size_t ) noexcept
+{
+	release( pointer );
+}
+
+
+void operator delete( void *pointer, std::nothrow_t const & ) noexcept
+{
+	release( pointer );
+}
+
+
+void operator delete[]( void *pointer, std::nothrow_t const & ) noexcept
+{
+	release( pointer );
+}
+
+
+//-------------------------------------------------------
+//	hud counters
+//-------------------------------------------------------
+
+namespace
+{
+	profiler::Counter frameAllocationCounters[ SUBSYSTEM_COUNT ] = {
+		{ "ALLOCS OTHER" }, { "ALLOCS GAME" }, { "ALLOCS SCENE" }, { "ALLOCS BACKGROUND" }
+	};
+	profiler::Counter frameByteCounters[ SUBSYSTEM_COUNT ] = {
+		{ "ALLOC BYTES OTHER" }, { "ALLOC BYTES GAME" }, { "ALLOC BYTES SCENE" }, { "ALLOC BYTES BACKGROUND" }
+	};
+	profiler::Counter steadyStateCounter( "STEADY STATE ALLOCS" );
+}
+
+
+//-------------------------------------------------------
+//	public interface
+//-------------------------------------------------------
+
+namespace allocations
+{
+	Scope::Scope( Subsystem subsystem ) :
+		previous( currentSubsystem )
+	{
+		currentSubsystem = subsystem;
+	}
+
+
+	Scope::~Scope()
+	{
+		currentSubsystem = previous;
+	}
+
+
+	//-------------------------------------------------------
+	SteadyStateScope::SteadyStateScope( bool isArmed ) :
+		isArmed( isArmed )
+	{
+		if ( isArmed )
+			++armedSteadyStateDepth;
+	}
+
+
+	SteadyStateScope::~SteadyStateScope()
+	{
+		if ( isArmed )
+			--armedSteadyStateDepth;
+	}
+
+
+	//-------------------------------------------------------
+	void endFrame()
+	{
+		for ( int subsystem = 0; subsystem < SUBSYSTEM_COUNT; ++subsystem )
+		{
+			AtomicStats &frame = currentFrame[ subsystem ];
+			Stats stats = {
+				frame.allocationCount.exchange( 0, std::memory_order_relaxed ),
+				frame.allocatedBytes.exchange( 0, std::memory_order_relaxed ),
+				frame.freeCount.exchange( 0, std::memory_order_relaxed ) };
+			lastFrame[ subsystem ] = stats;
+			total[ subsystem ].allocationCount.fetch_add( stats.allocationCount, std::memory_order_relaxed );
+			total[ subsystem ].allocatedBytes.fetch_add( stats.allocatedBytes, std::memory_order_relaxed );
+			total[ subsystem ].freeCount.fetch_add( stats.freeCount, std::memory_order_relaxed );
+
+			frameAllocationCounters[ subsystem ].set( stats.allocationCount );
+			frameByteCounters[ subsystem ].set( stats.allocatedBytes );
+		}
+		steadyStateCounter.set( getSteadyStateViolationCount() );
+	}
+
+
+	Stats getFrameStats( Subsystem subsystem )
+	{
+		return lastFrame[ subsystem ];
+	}
+
+
+	Stats getTotalStats( Subsystem subsystem )
+	{
+		return load( total[ subsystem ] );
+	}
+
+
+	int64_t getSteadyStateViolationCount()
+	{
+		return steadyStateViolationCount.load( std::memory_order_relaxed );
+	}
+}
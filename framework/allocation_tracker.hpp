@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	global operator new and delete counted per frame and
+//	per subsystem, plus a guard flagging allocations in
+//	code that must not allocate once the game warmed up.
+//	Build with WOTS_ALLOCATION_GUARD to assert on them,
+//	as tools/steady_state_test.cpp does
+//-------------------------------------------------------
+
+namespace allocations
+{
+	// simulation steps after a game start that may still allocate while pools,
+	// lists and streamed chunks grow to their working size
+	constexpr int WARM_UP_STEPS = 600;
+
+	enum Subsystem
+	{
+		SUBSYSTEM_OTHER,
+		SUBSYSTEM_GAME,
+		SUBSYSTEM_SCENE,
+		// loader and writer threads
+		SUBSYSTEM_BACKGROUND,
+		SUBSYSTEM_COUNT
+	};
+
+	// allocations of the calling thread are attributed to subsystem until the scope ends
+	class Scope
+	{
+	public:
+		explicit Scope( Subsystem subsystem );
+		~Scope();
+
+		Scope( Scope const & ) = delete;
+		Scope &operator=( Scope const & ) = delete;
+
+	private:
+		Subsystem previous;
+	};
+
+	// allocations of the calling thread inside an armed scope are steady state violations
+	class SteadyStateScope
+	{
+	public:
+		explicit SteadyStateScope( bool isArmed );
+		~SteadyStateScope();
+
+		SteadyStateScope( SteadyStateScope const & ) = delete;
+		SteadyStateScope &operator=( SteadyStateScope const & ) = delete;
+
+	private:
+		bool isArmed;
+	};
+
+	struct Stats
+	{
+		int64_t allocationCount;
+		int64_t allocatedBytes;
+		int64_t freeCount;
+	};
+
+	// closes the current frame and publishes it to the profiler counters
+	void endFrame();
+	// last closed frame
+	Stats getFrameStats( Subsystem subsystem );
+	Stats getTotalStats( Subsystem subsystem );
+	int64_t getSteadyStateViolationCount();
+}
@@ -4,10 +4,65 @@
 #include <windowsx.h>
 #include <GL/gl.h>
 
+#include "allocation_tracker.hpp"
+#include "frame_governor.hpp"
 #include "game.hpp"
+#include "hud.hpp"
+#include "profiler.hpp"
 #include "scene.hpp"
 
 
+//-------------------------------------------------------
+//	steady state allocation guard
+//-------------------------------------------------------
+
+namespace
+{
+	int stepsSinceGameStart = 0;
+
+
+	void restartWarmUp()
+	{
+		stepsSinceGameStart = 0;
+	}
+
+
+	bool isSteadyState()
+	{
+		return stepsSinceGameStart >= allocations::WARM_UP_STEPS;
+	}
+}
+
+
+//-------------------------------------------------------
+//	time warp
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr int TIME_WARP_FACTORS[] = { 1, 10, 100 };
+	constexpr int TIME_WARP_COUNT = sizeof( TIME_WARP_FACTORS ) / sizeof( TIME_WARP_FACTORS[ 0 ] );
+	// motion is integrated exactly for any step, but steering and landing are decided
+	// once per step, so a warped step stays at most this many simulation steps long
+	constexpr int MAX_WARP_STEP_MULTIPLIER = 10;
+
+	int timeWarpIndex = 0;
+	profiler::Counter timeWarpCounter( "TIME WARP" );
+
+
+	void cycleTimeWarp()
+	{
+		timeWarpIndex = ( timeWarpIndex + 1 ) % TIME_WARP_COUNT;
+	}
+
+
+	int getTimeWarpFactor()
+	{
+		return TIME_WARP_FACTORS[ timeWarpIndex ];
+	}
+}
+
+
 //-------------------------------------------------------
 //	window related stuff
 //-------------------------------------------------------
@@ -20,6 +75,15 @@ namespace
 	constexpr int WINDOW_HEIGHT = 768;
 
 
+	//-------------------------------------------------------
+	// input latency starts when the event was queued, a busy frame delays reading it the most
+	void stampInput()
+	{
+		DWORD queuedMilliseconds = GetTickCount() - ( DWORD )GetMessageTime();
+		profiler::inputReceived( queuedMilliseconds / 1000.f );
+	}
+
+
 	//-------------------------------------------------------
 	LRESULT CALLBACK windowProcedure( HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam )
 	{
@@ -30,6 +94,9 @@ namespace
 				break;
 
 			case WM_KEYDOWN:
+				// auto repeat changes nothing on screen
+				if ( !( lParam & ( 1 << 30 ) ) )
+					stampInput();
 				if ( wParam == 'W' || wParam == VK_UP )
 					game::keyPressed( game::KEY_FORWARD );
 				if ( wParam == 'S' || wParam == VK_DOWN )
@@ -38,8 +105,14 @@ namespace
 					game::keyPressed( game::KEY_LEFT );
 				if ( wParam == 'D' || wParam == VK_RIGHT )
 					game::keyPressed( game::KEY_RIGHT );
+				if ( wParam == 'L' )
+					game::keyPressed( game::KEY_SALVO );
 				if ( wParam == VK_ESCAPE )
 					DestroyWindow( windowHandle );
+				if ( wParam == VK_F1 )
+					hud::toggle();
+				if ( wParam == 'T' )
+					cycleTimeWarp();
 				break;
 
 			case WM_KEYUP:
@@ -51,15 +124,19 @@ namespace
 					game::keyReleased( game::KEY_LEFT );
 				if ( wParam == 'D' || wParam == VK_RIGHT )
 					game::keyReleased( game::KEY_RIGHT );
+				if ( wParam == 'L' )
+					game::keyReleased( game::KEY_SALVO );
 				if ( wParam == VK_SPACE )
 				{
 					game::deinit();
 					game::init();
+					restartWarmUp();
 				}
 				break;
 
 			case WM_LBUTTONUP:
 			case WM_RBUTTONUP:
+				stampInput();
 				game::mouseClicked( ( float )( GET_X_LPARAM( lParam ) ) / WINDOW_WIDTH,
 									1.f - ( float )( GET_Y_LPARAM( lParam ) ) / WINDOW_HEIGHT,
 									message == WM_LBUTTONUP );
@@ -175,10 +252,19 @@ namespace
 
 
 	//-------------------------------------------------------
-	void draw()
+	void draw( float stepFraction )
+	{
+		profiler::ScopedTiming timing( profiler::TIMING_DRAW );
+		allocations::Scope allocationScope( allocations::SUBSYSTEM_SCENE );
+		scene::draw( stepFraction );
+	}
+
+
+	//-------------------------------------------------------
+	void present()
 	{
-		scene::draw();
 		SwapBuffers( windowDC );
+		profiler::framePresented();
 
 		assert( glGetError() == 0 );
 	}
@@ -192,9 +278,15 @@ namespace
 namespace
 {
 	constexpr int MAX_FPS = 150;
+	// simulation always advances by the same step, so its result doesn't depend on frame rate
+	constexpr int SIMULATION_RATE = 60;
+	constexpr double SIMULATION_DT = 1.0 / SIMULATION_RATE;
+	// after a long stall simulation falls behind instead of freezing the window with catch up steps
+	constexpr int MAX_STEPS_PER_FRAME = 5;
 
 	LARGE_INTEGER clockFrequency;
 	LARGE_INTEGER clockLastTick;
+	double simulationLag = 0.0;
 
 
 	//-------------------------------------------------------
@@ -202,29 +294,83 @@ namespace
 	{
 		QueryPerformanceFrequency( &clockFrequency );
 		QueryPerformanceCounter( &clockLastTick );
+		simulationLag = 0.0;
 	}
 
 
 	//-------------------------------------------------------
 	void update()
 	{
-		float dt = 0.f;
+		double deltaTime = 0.0;
 
 		while ( true )
 		{
 			LARGE_INTEGER clockTick;
 			QueryPerformanceCounter( &clockTick );
-			double deltaTime = ( double )( clockTick.QuadPart - clockLastTick.QuadPart ) / ( double )clockFrequency.QuadPart;
+			deltaTime = ( double )( clockTick.QuadPart - clockLastTick.QuadPart ) / ( double )clockFrequency.QuadPart;
 			if ( deltaTime >= 1.0 / MAX_FPS )
 			{
-				dt = ( float )deltaTime;
 				clockLastTick = clockTick;
 				break;
 			}
 		}
 
-		game::update( dt );
-		scene::update( dt );
+		profiler::recordTiming( profiler::TIMING_FRAME, ( float )deltaTime );
+		simulationLag += deltaTime;
+
+		// time warp stretches every simulation step, x100 takes ten long steps per tick instead of a hundred
+		int warpFactor = getTimeWarpFactor();
+		int stepMultiplier = warpFactor < MAX_WARP_STEP_MULTIPLIER ? warpFactor : MAX_WARP_STEP_MULTIPLIER;
+		int warpStepsPerTick = warpFactor / stepMultiplier;
+		timeWarpCounter.set( warpFactor );
+
+		int steps = 0;
+		while ( simulationLag >= SIMULATION_DT && steps < MAX_STEPS_PER_FRAME )
+		{
+			// drawing interpolates across the whole tick, not only its last warp step
+			scene::beginStep();
+			for ( int warpStep = 0; warpStep < warpStepsPerTick; ++warpStep )
+			{
+				profiler::stepStarted();
+				{
+					profiler::ScopedTiming timing( profiler::TIMING_STEP );
+					allocations::Scope allocationScope( allocations::SUBSYSTEM_GAME );
+					allocations::SteadyStateScope steadyState( isSteadyState() );
+					game::update( ( float )( SIMULATION_DT * stepMultiplier ) );
+				}
+				++stepsSinceGameStart;
+			}
+			{
+				allocations::Scope allocationScope( allocations::SUBSYSTEM_GAME );
+				allocations::SteadyStateScope steadyState( isSteadyState() );
+				game::prepareDraw();
+			}
+			simulationLag -= SIMULATION_DT;
+			++steps;
+		}
+		if ( steps == MAX_STEPS_PER_FRAME && simulationLag >= SIMULATION_DT )
+			simulationLag = 0.0;
+
+		allocations::Scope allocationScope( allocations::SUBSYSTEM_SCENE );
+		allocations::SteadyStateScope steadyState( isSteadyState() );
+		scene::update( ( float )deltaTime );
+	}
+
+
+	//-------------------------------------------------------
+	// the frame starts when the wait for the frame rate cap ends
+	float getFrameWorkSeconds()
+	{
+		LARGE_INTEGER clockTick;
+		QueryPerformanceCounter( &clockTick );
+		return ( float )( ( double )( clockTick.QuadPart - clockLastTick.QuadPart ) / ( double )clockFrequency.QuadPart );
+	}
+
+
+	//-------------------------------------------------------
+	float getStepFraction()
+	{
+		return ( float )( simulationLag / SIMULATION_DT );
 	}
 }
 
@@ -241,10 +387,15 @@ namespace engine
 		initOGL();
 		initClock();
 		game::init();
+		restartWarmUp();
 		while ( processWindowMessages() )
 		{
 			update();
-			draw();
+			draw( getStepFraction() );
+			// before the swap, which waits for vertical sync without doing any work
+			governor::frameFinished( getFrameWorkSeconds() );
+			present();
+			allocations::endFrame();
 		}
 		game::deinit();
 		deinitOGL();
@@ -0,0 +1,70 @@
+#include "frame_governor.hpp"
+#include "profiler.hpp"
+
+
+namespace
+{
+	// simulation steps at 60 Hz, frames longer than a step make it catch up with several
+	constexpr float BUDGET_SECONDS = 1.f / 60.f;
+	// smoothed work over the budget, or a single frame this far over it, drops a level
+	constexpr float SMOOTHING = 0.1f;
+	constexpr float SPIKE_SHARE = 1.5f;
+	// a level comes back after this many frames in a row under a share of the budget
+	constexpr float HEADROOM_SHARE = 0.6f;
+	constexpr int RECOVERY_FRAMES = 120;
+	// frames the smoothed work needs to follow a level change before the next drop
+	constexpr int SETTLE_FRAMES = 15;
+
+	constexpr governor::Quality LEVELS[] = {
+		{ 1.f, 1, 1.f, true },
+		{ 0.5f, 1, 1.f, true },
+		{ 0.5f, 2, 0.75f, true },
+		{ 0.25f, 4, 0.5f, false },
+		{ 0.f, 8, 0.5f, false },
+	};
+	constexpr int LEVEL_COUNT = sizeof( LEVELS ) / sizeof( LEVELS[ 0 ] );
+
+	int level = 0;
+	float smoothedWork = 0.f;
+	int framesWithHeadroom = 0;
+	int framesSinceChange = 0;
+	profiler::Counter levelCounter( "QUALITY LEVEL" );
+
+
+	void changeLevel( int newLevel )
+	{
+		level = newLevel;
+		framesSinceChange = 0;
+		framesWithHeadroom = 0;
+		levelCounter.set( level );
+	}
+}
+
+
+namespace governor
+{
+	void frameFinished( float workSeconds )
+	{
+		smoothedWork += ( workSeconds - smoothedWork ) * SMOOTHING;
+		++framesSinceChange;
+		framesWithHeadroom = workSeconds < HEADROOM_SHARE * BUDGET_SECONDS ? framesWithHeadroom + 1 : 0;
+
+		bool isOverBudget = smoothedWork > BUDGET_SECONDS || workSeconds > SPIKE_SHARE * BUDGET_SECONDS;
+		if ( isOverBudget && framesSinceChange >= SETTLE_FRAMES && level < LEVEL_COUNT - 1 )
+			changeLevel( level + 1 );
+		else if ( framesWithHeadroom >= RECOVERY_FRAMES && level > 0 )
+			changeLevel( level - 1 );
+	}
+
+
+	Quality const &getQuality()
+	{
+		return LEVELS[ level ];
+	}
+
+
+	int getLevel()
+	{
+		return level;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+
+//-------------------------------------------------------
+//	frame budget governor: trades visual quality for frame
+//	time. Quality drops a level as soon as frames run over
+//	the budget and comes back one level at a time only after
+//	a long run of frames with plenty of headroom, so it
+//	doesn't oscillate around the budget
+//-------------------------------------------------------
+
+namespace governor
+{
+	struct Quality
+	{
+		// scale of the trail particle emission rate of every mesh, zero emits none
+		float trailRate;
+		// only every seaSlotStride-th sea particle slot is drawn, a power of two,
+		// so a sparser sea keeps a subset of the particles of a denser one
+		int seaSlotStride;
+		// scale of every line width, widths never go under a pixel
+		float lineWidth;
+		// mesh outlines are drawn only with detail
+		bool isDetailed;
+	};
+
+	// work of the frame in seconds, without the wait for the frame rate cap
+	void frameFinished( float workSeconds );
+
+	// settings of the current level, level 0 is the full quality
+	Quality const &getQuality();
+	int getLevel();
+}
@@ -2,9 +2,13 @@
 #pragma once
 namespace game
 {
+	// command line options of the game, false after printing the usage when they are wrong
+	bool parseArguments( int argc, char **argv );
 	void init();
 	void deinit();
 	void update( float dt );
+	// places what updates skip, once per tick before it is drawn
+	void prepareDraw();
 
 	enum
 	{
@@ -12,11 +16,16 @@ namespace game
 		KEY_BACKWARD,
 		KEY_LEFT,
 		KEY_RIGHT,
+		// launches every ready aircraft one after another
+		KEY_SALVO,
 		KEY_COUNT
 	};
 
 	void keyPressed( int key );
 	void keyReleased( int key );
 	void mouseClicked( float x, float y, bool isLeftButton );
+
+	// hash of the whole simulation state, lockstep peers compare it every frame
+	unsigned int getStateHash();
 }
 
@@ -0,0 +1,206 @@
+#include <windows.h>
+#include <GL/gl.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "hud.hpp"
+#include "profiler.hpp"
+
+
+//-------------------------------------------------------
+//	bitmap font
+//-------------------------------------------------------
+
+namespace
+{
+	// 3x5 glyphs, a row per byte from the top, bit 2 is the leftmost pixel
+	constexpr int GLYPH_WIDTH = 3;
+	constexpr int GLYPH_HEIGHT = 5;
+
+	constexpr uint8_t DIGIT_GLYPHS[ 10 ][ GLYPH_HEIGHT ] = {
+		{ 7, 5, 5, 5, 7 }, { 2, 6, 2, 2, 7 }, { 7, 1, 7, 4, 7 }, { 7, 1, 3, 1, 7 }, { 5, 5, 7, 1, 1 },
+		{ 7, 4, 7, 1, 7 }, { 7, 4, 7, 5, 7 }, { 7, 1, 1, 2, 2 }, { 7, 5, 7, 5, 7 }, { 7, 5, 7, 1, 7 },
+	};
+
+	constexpr uint8_t LETTER_GLYPHS[ 26 ][ GLYPH_HEIGHT ] = {
+		{ 2, 5, 7, 5, 5 }, { 6, 5, 6, 5, 6 }, { 3, 4, 4, 4, 3 }, { 6, 5, 5, 5, 6 }, { 7, 4, 6, 4, 7 },
+		{ 7, 4, 6, 4, 4 }, { 3, 4, 5, 5, 3 }, { 5, 5, 7, 5, 5 }, { 7, 2, 2, 2, 7 }, { 1, 1, 1, 5, 2 },
+		{ 5, 5, 6, 5, 5 }, { 4, 4, 4, 4, 7 }, { 5, 7, 7, 5, 5 }, { 6, 5, 5, 5, 5 }, { 2, 5, 5, 5, 2 },
+		{ 6, 5, 6, 4, 4 }, { 2, 5, 5, 6, 3 }, { 6, 5, 6, 5, 5 }, { 3, 4, 2, 1, 6 }, { 7, 2, 2, 2, 2 },
+		{ 5, 5, 5, 5, 7 }, { 5, 5, 5, 5, 2 }, { 5, 5, 7, 7, 5 }, { 5, 5, 2, 5, 5 }, { 5, 5, 2, 2, 2 },
+		{ 7, 1, 2, 4, 7 },
+	};
+
+	constexpr uint8_t DOT_GLYPH[ GLYPH_HEIGHT ] = { 0, 0, 0, 0, 2 };
+	constexpr uint8_t COLON_GLYPH[ GLYPH_HEIGHT ] = { 0, 2, 0, 2, 0 };
+	constexpr uint8_t MINUS_GLYPH[ GLYPH_HEIGHT ] = { 0, 0, 7, 0, 0 };
+	constexpr uint8_t PERCENT_GLYPH[ GLYPH_HEIGHT ] = { 5, 1, 2, 4, 5 };
+	constexpr uint8_t SLASH_GLYPH[ GLYPH_HEIGHT ] = { 1, 1, 2, 4, 4 };
+
+
+	// lower case is drawn as upper case, unknown characters as blanks
+	uint8_t const *getGlyph( char character )
+	{
+		if ( character >= '0' && character <= '9' )
+			return DIGIT_GLYPHS[ character - '0' ];
+		if ( character >= 'A' && character <= 'Z' )
+			return LETTER_GLYPHS[ character - 'A' ];
+		if ( character >= 'a' && character <= 'z' )
+			return LETTER_GLYPHS[ character - 'a' ];
+		switch ( character )
+		{
+			case '.': return DOT_GLYPH;
+			case ':': return COLON_GLYPH;
+			case '-': return MINUS_GLYPH;
+			case '%': return PERCENT_GLYPH;
+			case '/': return SLASH_GLYPH;
+		}
+		return nullptr;
+	}
+}
+
+
+//-------------------------------------------------------
+//	overlay
+//-------------------------------------------------------
+
+namespace
+{
+	// screen pixels per font pixel
+	constexpr float FONT_SCALE = 2.f;
+	constexpr float CHARACTER_ADVANCE = ( GLYPH_WIDTH + 1 ) * FONT_SCALE;
+	constexpr float LINE_ADVANCE = ( GLYPH_HEIGHT + 2 ) * FONT_SCALE;
+	constexpr float MARGIN = 8.f;
+	constexpr int MAX_LINES = 40;
+	constexpr int MAX_LINE_LENGTH = 64;
+
+	bool isShown = false;
+	char lines[ MAX_LINES ][ MAX_LINE_LENGTH ];
+	int lineCount = 0;
+
+
+	void addTimingLine( char const *name, profiler::Timing timing )
+	{
+		profiler::Percentiles percentiles = profiler::getPercentiles( timing );
+		std::snprintf( lines[ lineCount++ ], MAX_LINE_LENGTH, "%-9s P50 %6.2f  P95 %6.2f  P99 %6.2f",
+			name, percentiles.p50 * 1000.f, percentiles.p95 * 1000.f, percentiles.p99 * 1000.f );
+	}
+
+
+	// sample counts per bucket under a row of the bucket bounds in milliseconds
+	void addHistogramLines( char const *name, profiler::Timing timing )
+	{
+		int length = std::snprintf( lines[ lineCount ], MAX_LINE_LENGTH, "%-10s", "UNDER MS" );
+		for ( int bucket = 0; bucket < profiler::HISTOGRAM_BUCKET_COUNT - 1; ++bucket )
+			length += std::snprintf( lines[ lineCount ] + length, MAX_LINE_LENGTH - length, " %4d", 1 << bucket );
+		std::snprintf( lines[ lineCount++ ] + length, MAX_LINE_LENGTH - length, " %4s", "MORE" );
+
+		profiler::Histogram histogram = profiler::getHistogram( timing );
+		length = std::snprintf( lines[ lineCount ], MAX_LINE_LENGTH, "%-10s", name );
+		for ( int count : histogram.bucketCounts )
+			length += std::snprintf( lines[ lineCount ] + length, MAX_LINE_LENGTH - length, " %4d", count );
+		++lineCount;
+	}
+
+
+	void collectLines()
+	{
+		lineCount = 0;
+		addTimingLine( "FRAME MS", profiler::TIMING_FRAME );
+		addTimingLine( "STEP MS", profiler::TIMING_STEP );
+		addTimingLine( "DRAW MS", profiler::TIMING_DRAW );
+		addTimingLine( "IN-SIM MS", profiler::TIMING_INPUT_TO_STEP );
+		addTimingLine( "SIM-VIS MS", profiler::TIMING_STEP_TO_PRESENT );
+		addTimingLine( "IN-VIS MS", profiler::TIMING_INPUT_TO_PRESENT );
+		addHistogramLines( "IN-VIS", profiler::TIMING_INPUT_TO_PRESENT );
+		for ( int index = 0; index < profiler::getCounterCount() && lineCount < MAX_LINES; ++index )
+		{
+			profiler::Counter const &counter = profiler::getCounter( index );
+			std::snprintf( lines[ lineCount++ ], MAX_LINE_LENGTH, "%-20s %8lld", counter.getName(), ( long long )counter.get() );
+		}
+	}
+
+
+	// appends quads of the lit pixels, baseline at y
+	void drawText( char const *text, float x, float y )
+	{
+		for ( ; *text; ++text, x += CHARACTER_ADVANCE )
+		{
+			uint8_t const *glyph = getGlyph( *text );
+			if ( !glyph )
+				continue;
+			for ( int row = 0; row < GLYPH_HEIGHT; ++row )
+			{
+				float top = y + ( GLYPH_HEIGHT - row ) * FONT_SCALE;
+				for ( int column = 0; column < GLYPH_WIDTH; ++column )
+				{
+					if ( !( glyph[ row ] & ( 4 >> column ) ) )
+						continue;
+					float left = x + column * FONT_SCALE;
+					glVertex2f( left, top - FONT_SCALE );
+					glVertex2f( left + FONT_SCALE, top - FONT_SCALE );
+					glVertex2f( left + FONT_SCALE, top );
+					glVertex2f( left, top );
+				}
+			}
+		}
+	}
+}
+
+
+namespace hud
+{
+	void toggle()
+	{
+		isShown = !isShown;
+	}
+
+
+	void draw()
+	{
+		if ( !isShown )
+			return;
+		collectLines();
+
+		GLint viewport[ 4 ];
+		glGetIntegerv( GL_VIEWPORT, viewport );
+		float width = ( float )viewport[ 2 ];
+		float height = ( float )viewport[ 3 ];
+
+		// one unit is one screen pixel, origin at the lower left corner
+		glMatrixMode( GL_PROJECTION );
+		glPushMatrix();
+		glLoadIdentity();
+		glTranslatef( -1.f, -1.f, 0.f );
+		glScalef( 2.f / width, 2.f / height, 1.f );
+		glMatrixMode( GL_MODELVIEW );
+		glPushMatrix();
+		glLoadIdentity();
+
+		size_t longestLine = 0;
+		for ( int index = 0; index < lineCount; ++index )
+			longestLine = std::max( longestLine, std::strlen( lines[ index ] ) );
+		float panelRight = MARGIN * 2.f + longestLine * CHARACTER_ADVANCE;
+		float panelBottom = height - MARGIN * 2.f - lineCount * LINE_ADVANCE;
+
+		glBegin( GL_QUADS );
+		glColor3f( 0.f, 0.f, 0.1f );
+		glVertex2f( 0.f, panelBottom );
+		glVertex2f( panelRight, panelBottom );
+		glVertex2f( panelRight, height );
+		glVertex2f( 0.f, height );
+
+		glColor3f( 0.9f, 0.9f, 0.6f );
+		for ( int index = 0; index < lineCount; ++index )
+			drawText( lines[ index ], MARGIN, height - MARGIN - ( index + 1 ) * LINE_ADVANCE );
+		glEnd();
+
+		glPopMatrix();
+		glMatrixMode( GL_PROJECTION );
+		glPopMatrix();
+		glMatrixMode( GL_MODELVIEW );
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+
+//-------------------------------------------------------
+//	performance overlay: frame, step, draw and input latency
+//	percentiles and every profiler counter, printed with
+//	a built-in bitmap font, so it works on any build
+//-------------------------------------------------------
+
+namespace hud
+{
+	// hidden at start, the engine toggles it with F1
+	void toggle();
+
+	// draws over the current frame in screen space, restores the scene matrices
+	void draw();
+}
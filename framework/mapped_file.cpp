@@ -0,0 +1,167 @@
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.hpp"
+
+
+//-------------------------------------------------------
+//	platform independent part
+//-------------------------------------------------------
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+//-------------------------------------------------------
+bool MappedFile::isOpen() const
+{
+	return data != nullptr;
+}
+
+
+//-------------------------------------------------------
+uint8_t const *MappedFile::getData() const
+{
+	return data;
+}
+
+
+//-------------------------------------------------------
+size_t MappedFile::getSize() const
+{
+	return size;
+}
+
+
+#ifdef _WIN32
+
+//-------------------------------------------------------
+//	windows mapping
+//-------------------------------------------------------
+
+bool MappedFile::open( char const *path )
+{
+	close();
+
+	HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 )
+	{
+		CloseHandle( file );
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( !mapping )
+	{
+		CloseHandle( file );
+		return false;
+	}
+
+	void *view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	if ( !view )
+	{
+		CloseHandle( mapping );
+		CloseHandle( file );
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast< uint8_t const * >( view );
+	size = ( size_t )fileSize.QuadPart;
+	return true;
+}
+
+
+//-------------------------------------------------------
+void MappedFile::close()
+{
+	if ( !data )
+		return;
+	UnmapViewOfFile( data );
+	CloseHandle( mappingHandle );
+	CloseHandle( fileHandle );
+	data = nullptr;
+	size = 0;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
+
+
+//-------------------------------------------------------
+void MappedFile::release( size_t offset, size_t length )
+{
+	// removes the range from the working set, clean file pages need no write back
+	if ( data && length > 0 )
+		VirtualUnlock( const_cast< uint8_t * >( data + offset ), length );
+}
+
+#else
+
+//-------------------------------------------------------
+//	posix mapping, used by offline tools
+//-------------------------------------------------------
+
+bool MappedFile::open( char const *path )
+{
+	close();
+
+	int file = ::open( path, O_RDONLY );
+	if ( file < 0 )
+		return false;
+
+	struct stat status;
+	if ( fstat( file, &status ) != 0 || status.st_size == 0 )
+	{
+		::close( file );
+		return false;
+	}
+
+	void *view = mmap( nullptr, ( size_t )status.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+	// mapping stays valid after the descriptor is closed
+	::close( file );
+	if ( view == MAP_FAILED )
+		return false;
+
+	data = static_cast< uint8_t const * >( view );
+	size = ( size_t )status.st_size;
+	return true;
+}
+
+
+//-------------------------------------------------------
+void MappedFile::close()
+{
+	if ( !data )
+		return;
+	munmap( const_cast< uint8_t * >( data ), size );
+	data = nullptr;
+	size = 0;
+}
+
+
+//-------------------------------------------------------
+void MappedFile::release( size_t offset, size_t length )
+{
+	if ( !data || length == 0 )
+		return;
+	// madvise wants a page aligned start
+	size_t pageSize = ( size_t )sysconf( _SC_PAGESIZE );
+	size_t begin = offset / pageSize * pageSize;
+	madvise( const_cast< uint8_t * >( data + begin ), offset + length - begin, MADV_DONTNEED );
+}
+
+#endif
@@ -0,0 +1,40 @@
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	read only file mapped into memory, pages are loaded
+//	by the os on first touch and may be dropped again
+//	under memory pressure, so large data files cost only
+//	what is actually being read
+//-------------------------------------------------------
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile( MappedFile const & ) = delete;
+	MappedFile &operator=( MappedFile const & ) = delete;
+
+	bool open( char const *path );
+	void close();
+
+	bool isOpen() const;
+	uint8_t const *getData() const;
+	size_t getSize() const;
+
+	// hints the os that the range won't be read soon, its pages may be reclaimed first
+	void release( size_t offset, size_t length );
+
+private:
+	uint8_t const *data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+#endif
+};
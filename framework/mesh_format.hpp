@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	mesh file layout, all values little-endian
+//
+//	header:		char magic[8], u32 version, u32 meshCount, u32 vertexCount
+//	directory:	meshCount * { char name[16], u32 firstTriangleVertex, u32 triangleVertexCount,
+//				u32 firstLineVertex, u32 lineVertexCount, f32 fill[3], f32 line[3], f32 lineWidth,
+//				f32 boundMinX, f32 boundMinY, f32 boundMaxX, f32 boundMaxY, f32 boundRadius,
+//				f32 trailInterval, f32 trailLife, f32 trail[3] }
+//	vertices:	vertexCount * { f32 x, f32 y }
+//
+//	Vertices are in mesh space with x along the heading, every fix up of
+//	the source geometry is baked in. Triangles are a plain list, outlines
+//	are stored as line segment pairs, so instances of one mesh batch into
+//	two draw calls. Vertices start 4 byte aligned and are drawn in place.
+//	Names are zero padded. A zero trail interval means no trail.
+//-------------------------------------------------------
+
+namespace scene
+{
+	namespace format
+	{
+		constexpr char FILE_MAGIC[ 8 ] = { 'W', 'O', 'T', 'S', 'M', 'S', 'H', '1' };
+		constexpr uint32_t VERSION = 1;
+
+		constexpr uint32_t NAME_SIZE = 16;
+		constexpr uint32_t HEADER_SIZE = 8 + 4 * 3;
+		constexpr uint32_t DIRECTORY_ENTRY_SIZE = NAME_SIZE + 4 * 4 + 4 * 3 + 4 * 3 + 4 + 4 * 5 + 4 * 2 + 4 * 3;
+		constexpr uint32_t VERTEX_SIZE = 4 * 2;
+	}
+}
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#include "profiler.hpp"
+
+
+//-------------------------------------------------------
+//	counters
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr int MAX_COUNTERS = 32;
+
+	// constant initialized, so counters constructed during static initialization find it ready
+	profiler::Counter *counters[ MAX_COUNTERS ];
+	std::atomic< int > counterCount( 0 );
+}
+
+
+namespace profiler
+{
+	Counter::Counter( char const *name ) :
+		value( 0 ),
+		name( name )
+	{
+		int index = counterCount.load( std::memory_order_relaxed );
+		assert( index < MAX_COUNTERS );
+		if ( index >= MAX_COUNTERS )
+			return;
+		counters[ index ] = this;
+		// publishes the slot only after it is filled
+		counterCount.store( index + 1, std::memory_order_release );
+	}
+
+
+	int getCounterCount()
+	{
+		return counterCount.load( std::memory_order_acquire );
+	}
+
+
+	Counter const &getCounter( int index )
+	{
+		assert( index >= 0 && index < getCounterCount() );
+		return *counters[ index ];
+	}
+}
+
+
+//-------------------------------------------------------
+//	timings
+//-------------------------------------------------------
+
+namespace
+{
+	// a sample slot is a single atomic float, readers may see a window mixing
+	// two frames but never a torn value
+	struct TimingWindow
+	{
+		std::atomic< float > samples[ profiler::TIMING_WINDOW ];
+		std::atomic< uint32_t > sampleCount;
+	};
+
+	TimingWindow timings[ profiler::TIMING_COUNT ];
+
+
+	int64_t getTicks()
+	{
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+
+
+	float ticksToSeconds( int64_t ticks )
+	{
+		return ( float )ticks * ( float )std::chrono::steady_clock::period::num / ( float )std::chrono::steady_clock::period::den;
+	}
+}
+
+
+namespace profiler
+{
+	void recordTiming( Timing timing, float seconds )
+	{
+		TimingWindow &window = timings[ timing ];
+		uint32_t index = window.sampleCount.fetch_add( 1, std::memory_order_relaxed );
+		window.samples[ index % TIMING_WINDOW ].store( seconds, std::memory_order_relaxed );
+	}
+
+
+	Percentiles getPercentiles( Timing timing )
+	{
+		TimingWindow const &window = timings[ timing ];
+		int count = ( int )std::min< uint32_t >( window.sampleCount.load( std::memory_order_relaxed ), TIMING_WINDOW );
+		if ( count == 0 )
+			return Percentiles{ 0.f, 0.f, 0.f };
+
+		float sorted[ TIMING_WINDOW ];
+		for ( int index = 0; index < count; ++index )
+			sorted[ index ] = window.samples[ index ].load( std::memory_order_relaxed );
+		std::sort( sorted, sorted + count );
+
+		auto at = [ & ]( float share ) { return sorted[ std::min( count - 1, ( int )( share * count ) ) ]; };
+		return Percentiles{ at( 0.5f ), at( 0.95f ), at( 0.99f ) };
+	}
+
+
+	Histogram getHistogram( Timing timing )
+	{
+		TimingWindow const &window = timings[ timing ];
+		int count = ( int )std::min< uint32_t >( window.sampleCount.load( std::memory_order_relaxed ), TIMING_WINDOW );
+
+		Histogram histogram = {};
+		for ( int index = 0; index < count; ++index )
+		{
+			float milliseconds = window.samples[ index ].load( std::memory_order_relaxed ) * 1000.f;
+			int bucket = 0;
+			for ( float bound = 1.f; bucket < HISTOGRAM_BUCKET_COUNT - 1 && milliseconds >= bound; bound *= 2.f )
+				++bucket;
+			++histogram.bucketCounts[ bucket ];
+		}
+		return histogram;
+	}
+
+
+	//-------------------------------------------------------
+	ScopedTiming::ScopedTiming( Timing timing ) :
+		timing( timing ),
+		startTicks( getTicks() )
+	{
+	}
+
+
+	ScopedTiming::~ScopedTiming()
+	{
+		recordTiming( timing, ticksToSeconds( getTicks() - startTicks ) );
+	}
+}
+
+
+//-------------------------------------------------------
+//	input latency
+//-------------------------------------------------------
+
+namespace
+{
+	// events beyond it between two presented frames are not measured, input comes a few per frame at most
+	constexpr int MAX_PENDING_INPUTS = 32;
+
+	struct PendingInput
+	{
+		int64_t receivedTicks;
+		// zero until a simulation step consumed the input
+		int64_t stepTicks;
+	};
+
+	struct InputLatencyState
+	{
+		PendingInput pending[ MAX_PENDING_INPUTS ];
+		int pendingCount;
+		uint32_t presentedFrameCount;
+		uint32_t lastInputFrame;
+	};
+
+	thread_local InputLatencyState inputLatency;
+}
+
+
+namespace profiler
+{
+	void inputReceived( float queuedSeconds )
+	{
+		if ( inputLatency.pendingCount == MAX_PENDING_INPUTS )
+			return;
+		int64_t queuedTicks = ( int64_t )( ( double )queuedSeconds * std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num );
+		inputLatency.pending[ inputLatency.pendingCount++ ] = PendingInput{ getTicks() - queuedTicks, 0 };
+	}
+
+
+	void stepStarted()
+	{
+		if ( inputLatency.pendingCount == 0 )
+			return;
+		int64_t ticks = getTicks();
+		for ( int index = 0; index < inputLatency.pendingCount; ++index )
+		{
+			PendingInput &input = inputLatency.pending[ index ];
+			if ( input.stepTicks != 0 )
+				continue;
+			input.stepTicks = ticks;
+			recordTiming( TIMING_INPUT_TO_STEP, ticksToSeconds( ticks - input.receivedTicks ) );
+		}
+	}
+
+
+	void framePresented()
+	{
+		++inputLatency.presentedFrameCount;
+		if ( inputLatency.pendingCount == 0 )
+			return;
+
+		// retires the consumed inputs, the rest wait for a step in received order
+		int64_t ticks = getTicks();
+		int keptCount = 0;
+		for ( int index = 0; index < inputLatency.pendingCount; ++index )
+		{
+			PendingInput const &input = inputLatency.pending[ index ];
+			if ( input.stepTicks == 0 )
+			{
+				inputLatency.pending[ keptCount++ ] = input;
+				continue;
+			}
+			recordTiming( TIMING_STEP_TO_PRESENT, ticksToSeconds( ticks - input.stepTicks ) );
+			recordTiming( TIMING_INPUT_TO_PRESENT, ticksToSeconds( ticks - input.receivedTicks ) );
+			inputLatency.lastInputFrame = inputLatency.presentedFrameCount;
+		}
+		inputLatency.pendingCount = keptCount;
+	}
+
+
+	uint32_t getPresentedFrameCount()
+	{
+		return inputLatency.presentedFrameCount;
+	}
+
+
+	uint32_t getLastInputFrame()
+	{
+		return inputLatency.lastInputFrame;
+	}
+}
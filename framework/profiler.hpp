@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	lock free counters and frame timings shown by the hud,
+//	cheap enough to update from hot paths of any thread
+//-------------------------------------------------------
+
+namespace profiler
+{
+	// named value, registers itself for the hud on construction and must outlive it,
+	// so counters are meant to be globals
+	class Counter
+	{
+	public:
+		Counter( char const *name );
+
+		Counter( Counter const & ) = delete;
+		Counter &operator=( Counter const & ) = delete;
+
+		void add( int64_t delta ) { value.fetch_add( delta, std::memory_order_relaxed ); }
+		void set( int64_t newValue ) { value.store( newValue, std::memory_order_relaxed ); }
+		int64_t get() const { return value.load( std::memory_order_relaxed ); }
+		char const *getName() const { return name; }
+
+	private:
+		std::atomic< int64_t > value;
+		char const *name;
+	};
+
+	int getCounterCount();
+	Counter const &getCounter( int index );
+
+
+	enum Timing
+	{
+		TIMING_FRAME,
+		TIMING_STEP,
+		TIMING_DRAW,
+		// input event to the start of the simulation step that consumes it
+		TIMING_INPUT_TO_STEP,
+		// that step start to the first presented frame showing its result
+		TIMING_STEP_TO_PRESENT,
+		TIMING_INPUT_TO_PRESENT,
+		TIMING_COUNT
+	};
+
+	// last TIMING_WINDOW samples of every timing are kept
+	constexpr int TIMING_WINDOW = 256;
+
+	void recordTiming( Timing timing, float seconds );
+
+	struct Percentiles
+	{
+		float p50;
+		float p95;
+		float p99;
+	};
+
+	// over the sliding window, zeros until the first sample
+	Percentiles getPercentiles( Timing timing );
+
+	// bucket i counts samples under 2^i milliseconds, the last one everything longer
+	constexpr int HISTOGRAM_BUCKET_COUNT = 10;
+
+	struct Histogram
+	{
+		int bucketCounts[ HISTOGRAM_BUCKET_COUNT ];
+	};
+
+	// over the same sliding window as the percentiles
+	Histogram getHistogram( Timing timing );
+
+
+	// records the lifetime of the scope
+	class ScopedTiming
+	{
+	public:
+		explicit ScopedTiming( Timing timing );
+		~ScopedTiming();
+
+		ScopedTiming( ScopedTiming const & ) = delete;
+		ScopedTiming &operator=( ScopedTiming const & ) = delete;
+
+	private:
+		Timing timing;
+		int64_t startTicks;
+	};
+
+
+	// input latency: the window backend stamps every input event, the next simulation step
+	// consumes the stamps and the next presented frame retires them into the latency timings.
+	// Stamps belong to the calling thread, so headless simulations on several threads keep apart.
+	// queuedSeconds is how long the event waited in the system queue before it was received
+	void inputReceived( float queuedSeconds );
+	void stepStarted();
+	void framePresented();
+
+	// presented frames of the calling thread so far, and the one that first showed the last retired input
+	uint32_t getPresentedFrameCount();
+	uint32_t getLastInputFrame();
+}
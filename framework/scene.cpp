@@ -3,10 +3,19 @@
 #include <GL/gl.h>
 
 #include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <vector>
 #include <algorithm>
-#include <random>
 
+#include "frame_governor.hpp"
+#include "hud.hpp"
+#include "mapped_file.hpp"
+#include "mesh_format.hpp"
+#include "profiler.hpp"
 #include "scene.hpp"
 
 
@@ -38,11 +47,16 @@ namespace
 	};
 
 
+	// enough for a few carriers worth of aircraft trails, the vector still grows past it
+	constexpr size_t INITIAL_PARTICLE_CAPACITY = 1024;
+
 	std::vector< Particle > particles;
 
 
 	void addParticle( float x, float y, float life, Color color )
 	{
+		if ( particles.capacity() == 0 )
+			particles.reserve( INITIAL_PARTICLE_CAPACITY );
 		Particle particle = { x, y, life, color };
 		particles.push_back( particle );
 	}
@@ -73,210 +87,510 @@ namespace
 
 
 //-------------------------------------------------------
-//	user interface: common mesh support
+//	procedural sea particles support
 //-------------------------------------------------------
 
-namespace scene
+namespace
 {
-	class Mesh
+	// sea particles are not stored: every cell of a world grid owns one particle per time slot,
+	// its spawn time and position inside the cell are derived from a hash of ( cell, slot )
+	constexpr float TIME_BETWEEN_SEA_PARTICLES = 0.02f;
+	constexpr float SEA_PARTICLE_LIFE = 3.f;
+	constexpr float SEA_CELL_SIZE = 1.5f;
+	// keeps the density of one particle per TIME_BETWEEN_SEA_PARTICLES over the whole view
+	constexpr double SEA_SLOT_DURATION = TIME_BETWEEN_SEA_PARTICLES * scene::VIEW_WIDTH * scene::VIEW_HEIGHT / ( SEA_CELL_SIZE * SEA_CELL_SIZE );
+	constexpr Color SEA_PARTICLE_COLOR = { 0.15f, 0.3f, 0.6f };
+
+	double seaTime = 0.0;
+	// sea pattern is fixed to the world, not to the floating origin of the game
+	double seaOriginX = 0.0;
+	double seaOriginY = 0.0;
+
+
+	uint32_t hashSeaSlot( int32_t cellX, int32_t cellY, int64_t slot, uint32_t salt )
 	{
-	public:
-		float positionX = 0.f;
-		float positionY = 0.f;
-		float angle = 0.f;
+		uint32_t hash = salt;
+		uint32_t keys[] = { ( uint32_t )cellX, ( uint32_t )cellY, ( uint32_t )slot, ( uint32_t )( ( uint64_t )slot >> 32 ) };
+		for ( uint32_t key : keys )
+		{
+			hash ^= key + 0x9e3779b9u + ( hash << 6 ) + ( hash >> 2 );
+			hash ^= hash >> 16;
+			hash *= 0x7feb352du;
+			hash ^= hash >> 15;
+			hash *= 0x846ca68bu;
+			hash ^= hash >> 16;
+		}
+		return hash;
+	}
 
-		virtual ~Mesh();
-		virtual void draw();
-		virtual void update( float dt );
 
-		static std::vector< Mesh* > meshes;
+	float hashToUnit( uint32_t hash )
+	{
+		return ( float )( hash >> 8 ) * ( 1.f / 16777216.f );
+	}
+
+
+	// slotStride thins the sea out, only slots divisible by it are drawn
+	void drawSeaParticles( float left, float bottom, float right, float top, int slotStride )
+	{
+		int32_t firstCellX = ( int32_t )std::floor( ( left + seaOriginX ) / SEA_CELL_SIZE );
+		int32_t lastCellX = ( int32_t )std::floor( ( right + seaOriginX ) / SEA_CELL_SIZE );
+		int32_t firstCellY = ( int32_t )std::floor( ( bottom + seaOriginY ) / SEA_CELL_SIZE );
+		int32_t lastCellY = ( int32_t )std::floor( ( top + seaOriginY ) / SEA_CELL_SIZE );
+
+		// a particle spawned inside slot k is alive now only if k lies in this range
+		int64_t firstSlot = ( int64_t )std::floor( ( seaTime - SEA_PARTICLE_LIFE ) / SEA_SLOT_DURATION );
+		int64_t lastSlot = ( int64_t )std::floor( seaTime / SEA_SLOT_DURATION );
+		// rounded down to the stride, slots before the range spawn particles that are already dead
+		firstSlot -= ( firstSlot % slotStride + slotStride ) % slotStride;
+
+		glLoadIdentity();
+		glPointSize( 2.f );
+		glBegin( GL_POINTS );
+		glColor3f( SEA_PARTICLE_COLOR.r, SEA_PARTICLE_COLOR.g, SEA_PARTICLE_COLOR.b );
+		for ( int32_t cellY = firstCellY; cellY <= lastCellY; ++cellY )
+		{
+			for ( int32_t cellX = firstCellX; cellX <= lastCellX; ++cellX )
+			{
+				for ( int64_t slot = firstSlot; slot <= lastSlot; slot += slotStride )
+				{
+					double spawnTime = ( ( double )slot + hashToUnit( hashSeaSlot( cellX, cellY, slot, 0u ) ) ) * SEA_SLOT_DURATION;
+					if ( spawnTime > seaTime || spawnTime + SEA_PARTICLE_LIFE <= seaTime )
+						continue;
+
+					float x = ( float )( ( ( double )cellX + hashToUnit( hashSeaSlot( cellX, cellY, slot, 1u ) ) ) * SEA_CELL_SIZE - seaOriginX );
+					float y = ( float )( ( ( double )cellY + hashToUnit( hashSeaSlot( cellX, cellY, slot, 2u ) ) ) * SEA_CELL_SIZE - seaOriginY );
+					if ( x < left || x > right || y < bottom || y > top )
+						continue;
+
+					glVertex2f( x, y );
+				}
+			}
+		}
+		glEnd();
+	}
+}
+
+
+//-------------------------------------------------------
+//	mesh types support
+//-------------------------------------------------------
+
+namespace
+{
+	// baked by wots_mesh_bake from assets/meshes.txt, mapped at first use
+	constexpr char const *MESH_FILE_PATH = "meshes.wsm";
+
+#include "default_meshes.inc"
+
+	struct MeshType
+	{
+		char name[ scene::format::NAME_SIZE ];
+		// mesh space vertices, read in place from the file
+		GLfloat const *triangleVertices;
+		GLsizei triangleVertexCount;
+		GLfloat const *lineVertices;
+		GLsizei lineVertexCount;
+		Color fill;
+		Color line;
+		float lineWidth;
+		float boundRadius;
+		float trailInterval;
+		float trailLife;
+		Color trail;
 	};
 
+	MappedFile meshFile;
+	std::vector< MeshType > meshTypes;
+	bool areMeshTypesLoaded = false;
 
-	//-------------------------------------------------------
-	std::vector< Mesh* > Mesh::meshes;
 
+	uint32_t readU32( uint8_t const *data )
+	{
+		return data[ 0 ] | ( uint32_t )data[ 1 ] << 8 | ( uint32_t )data[ 2 ] << 16 | ( uint32_t )data[ 3 ] << 24;
+	}
 
-	//-------------------------------------------------------
-	Mesh::~Mesh()
+
+	float readF32( uint8_t const *data )
 	{
+		uint32_t bits = readU32( data );
+		float value;
+		std::memcpy( &value, &bits, sizeof( value ) );
+		return value;
 	}
 
 
-	//-------------------------------------------------------
-	void Mesh::draw()
+	Color readColor( uint8_t const *data )
 	{
-		glLoadIdentity();
-		glTranslatef( positionX, positionY, 0.f );
-		glRotatef( angle * 180.f / 3.14159265f, 0.f, 0.f, 1.f );
+		return Color{ readF32( data ), readF32( data + 4 ), readF32( data + 8 ) };
 	}
 
 
-	//-------------------------------------------------------
-	void Mesh::update( float dt )
+	bool parseMeshTypes( uint8_t const *data, size_t size )
 	{
+		using namespace scene::format;
+
+		meshTypes.clear();
+		if ( size < HEADER_SIZE || std::memcmp( data, FILE_MAGIC, sizeof( FILE_MAGIC ) ) != 0 || readU32( data + 8 ) != VERSION )
+			return false;
+		uint32_t meshCount = readU32( data + 12 );
+		uint32_t vertexCount = readU32( data + 16 );
+		uint64_t verticesOffset = HEADER_SIZE + ( uint64_t )meshCount * DIRECTORY_ENTRY_SIZE;
+		if ( verticesOffset + ( uint64_t )vertexCount * VERTEX_SIZE > size )
+			return false;
+		GLfloat const *vertices = reinterpret_cast< GLfloat const * >( data + verticesOffset );
+
+		for ( uint32_t index = 0; index < meshCount; ++index )
+		{
+			uint8_t const *entry = data + HEADER_SIZE + index * DIRECTORY_ENTRY_SIZE;
+			uint8_t const *values = entry + NAME_SIZE;
+			uint32_t firstTriangleVertex = readU32( values );
+			uint32_t triangleVertexCount = readU32( values + 4 );
+			uint32_t firstLineVertex = readU32( values + 8 );
+			uint32_t lineVertexCount = readU32( values + 12 );
+			if ( ( uint64_t )firstTriangleVertex + triangleVertexCount > vertexCount || ( uint64_t )firstLineVertex + lineVertexCount > vertexCount ||
+				 entry[ NAME_SIZE - 1 ] != 0 )
+			{
+				meshTypes.clear();
+				return false;
+			}
+
+			MeshType type;
+			std::memcpy( type.name, entry, NAME_SIZE );
+			type.triangleVertices = vertices + 2 * firstTriangleVertex;
+			type.triangleVertexCount = ( GLsizei )triangleVertexCount;
+			type.lineVertices = vertices + 2 * firstLineVertex;
+			type.lineVertexCount = ( GLsizei )lineVertexCount;
+			type.fill = readColor( values + 16 );
+			type.line = readColor( values + 28 );
+			type.lineWidth = readF32( values + 40 );
+			// axis aligned bounds at 44 are for tools, drawing only needs the radius
+			type.boundRadius = readF32( values + 60 );
+			type.trailInterval = readF32( values + 64 );
+			type.trailLife = readF32( values + 68 );
+			type.trail = readColor( values + 72 );
+			meshTypes.push_back( type );
+		}
+		return true;
 	}
 
 
-	//-------------------------------------------------------
-	template< class MeshClass >
-	Mesh *createMesh()
+	// a mesh file next to the game overrides the built-in meshes, so new types need no rebuild
+	void loadMeshTypes()
 	{
-		Mesh *mesh = new MeshClass;
-		Mesh::meshes.push_back( mesh );
-		return mesh;
+		if ( areMeshTypesLoaded )
+			return;
+		areMeshTypesLoaded = true;
+		if ( meshFile.open( MESH_FILE_PATH ) )
+		{
+			if ( parseMeshTypes( meshFile.getData(), meshFile.getSize() ) )
+				return;
+			std::fprintf( stderr, "scene: %s is not a mesh file, using built-in meshes\n", MESH_FILE_PATH );
+			meshFile.close();
+		}
+		if ( !parseMeshTypes( DEFAULT_MESH_FILE, sizeof( DEFAULT_MESH_FILE ) ) )
+			assert( !"built-in meshes are broken, bake them again" );
 	}
 
 
-	//-------------------------------------------------------
-	void destroyMesh( Mesh *mesh )
+	int findMeshType( char const *name )
 	{
-		auto it = std::find( Mesh::meshes.begin(), Mesh::meshes.end(), mesh );
-		assert( it != Mesh::meshes.end() );
-		Mesh::meshes.erase( it );
-		delete mesh;
+		loadMeshTypes();
+		for ( size_t index = 0; index < meshTypes.size(); ++index )
+		{
+			if ( std::strncmp( meshTypes[ index ].name, name, scene::format::NAME_SIZE ) == 0 )
+				return ( int )index;
+		}
+		std::fprintf( stderr, "scene: no mesh named %s\n", name );
+		return -1;
 	}
 
 
-	//-------------------------------------------------------
-	void placeMesh( Mesh *mesh, float x, float y, float angle )
+	int getMaximalMeshVertexCount()
 	{
-		mesh->positionX = x;
-		mesh->positionY = y;
-		mesh->angle = angle;
+		loadMeshTypes();
+		int count = 0;
+		for ( MeshType const &type : meshTypes )
+			count = std::max( count, ( int )std::max( type.triangleVertexCount, type.lineVertexCount ) );
+		return count;
 	}
 }
 
 
 //-------------------------------------------------------
-//	user interface: ShipMesh support
+//	user interface: mesh support
 //-------------------------------------------------------
 
 namespace
 {
-	class ShipMesh : public scene::Mesh
+	// meshes come and go with every aircraft launch, their memory is recycled
+	// through a free list instead of going back to the heap
+	constexpr size_t MESH_BLOCK_SIZE = 96;
+
+	union MeshBlock
+	{
+		MeshBlock *next;
+		alignas( alignof( std::max_align_t ) ) char storage[ MESH_BLOCK_SIZE ];
+	};
+
+	MeshBlock *freeMeshBlocks = nullptr;
+}
+
+
+namespace scene
+{
+	class Mesh
 	{
 	public:
-		void draw() override;
+		// pose drawn this frame, interpolated between the previous and the placed one
+		float positionX = 0.f;
+		float positionY = 0.f;
+		float angle = 0.f;
+		// index into meshTypes, meshes of an unknown type are not drawn
+		int type = -1;
+
+		static void *operator new( size_t size );
+		static void operator delete( void *pointer );
+		void update( float dt );
+
+		void place( float x, float y, float newAngle );
+		void interpolate( float stepFraction );
+		void shift( float x, float y );
+
+		static std::vector< Mesh* > meshes;
+		static uint32_t step;
+
+	private:
+		float previousX = 0.f;
+		float previousY = 0.f;
+		float previousAngle = 0.f;
+		float placedX = 0.f;
+		float placedY = 0.f;
+		float placedAngle = 0.f;
+		float nextParticleTimeout = 0.f;
+		// meshes not placed during the current step stand still
+		uint32_t placedStep = 0;
+		bool isPlaced = false;
 	};
 
+	static_assert( sizeof( Mesh ) <= MESH_BLOCK_SIZE, "mesh doesn't fit into a pool block" );
+
+
+	//-------------------------------------------------------
+	std::vector< Mesh* > Mesh::meshes;
+	uint32_t Mesh::step = 0;
+
 
 	//-------------------------------------------------------
-	void ShipMesh::draw()
+	void *Mesh::operator new( size_t size )
 	{
-		Mesh::draw();
+		assert( size <= sizeof( MeshBlock ) );
+		if ( !freeMeshBlocks )
+			return ::operator new( sizeof( MeshBlock ) );
+		MeshBlock *block = freeMeshBlocks;
+		freeMeshBlocks = block->next;
+		return block;
+	}
 
-		glRotatef( -90.f, 0.f, 0.f, 1.f );
-		glScalef( 0.8f, 0.8f, 0.8f );
 
-		glBegin( GL_TRIANGLES );
-		glColor3f( 0.1f, 0.3f, 0.6f );
+	void Mesh::operator delete( void *pointer )
+	{
+		MeshBlock *block = static_cast< MeshBlock* >( pointer );
+		block->next = freeMeshBlocks;
+		freeMeshBlocks = block;
+	}
 
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.1f, 0.4f );
 
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( -0.1f, -0.4f );
+	//-------------------------------------------------------
+	void Mesh::update( float dt )
+	{
+		if ( type < 0 || meshTypes[ type ].trailInterval <= 0.f )
+			return;
+		MeshType const &meshType = meshTypes[ type ];
+		nextParticleTimeout -= dt;
+		if ( nextParticleTimeout <= 0.f )
+		{
+			nextParticleTimeout += meshType.trailInterval;
+			addParticle( positionX, positionY, meshType.trailLife, meshType.trail );
+		}
+	}
 
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( -0.15f, -0.1f );
 
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( 0.15f, -0.1f );
+	//-------------------------------------------------------
+	void Mesh::place( float x, float y, float newAngle )
+	{
+		if ( !isPlaced )
+		{
+			// just created mesh appears in place instead of flying in from the origin
+			placedX = x;
+			placedY = y;
+			placedAngle = newAngle;
+			isPlaced = true;
+		}
+		if ( placedStep != step )
+		{
+			previousX = placedX;
+			previousY = placedY;
+			previousAngle = placedAngle;
+			placedStep = step;
+		}
+		placedX = x;
+		placedY = y;
+		placedAngle = newAngle;
+	}
 
-		glEnd();
 
-		glLineWidth( 2.f );
-		glBegin( GL_LINE_LOOP );
-		glColor3f( 0.4f, 0.8f, 1.f );
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.15f, -0.1f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( -0.15f, -0.1f );
-		glEnd();
+	//-------------------------------------------------------
+	void Mesh::shift( float x, float y )
+	{
+		positionX -= x;
+		positionY -= y;
+		previousX -= x;
+		previousY -= y;
+		placedX -= x;
+		placedY -= y;
+	}
+
+
+	//-------------------------------------------------------
+	void Mesh::interpolate( float stepFraction )
+	{
+		if ( placedStep != step )
+		{
+			positionX = placedX;
+			positionY = placedY;
+			angle = placedAngle;
+			return;
+		}
+		positionX = previousX + ( placedX - previousX ) * stepFraction;
+		positionY = previousY + ( placedY - previousY ) * stepFraction;
+		// shortest way round, angles wrap at 2pi
+		float turn = std::remainder( placedAngle - previousAngle, 6.28318531f );
+		angle = previousAngle + turn * stepFraction;
+	}
+
+
+	//-------------------------------------------------------
+	Mesh *createMesh( char const *typeName )
+	{
+		Mesh *mesh = new Mesh;
+		mesh->type = findMeshType( typeName );
+		Mesh::meshes.push_back( mesh );
+		return mesh;
 	}
-}
 
 
-namespace scene
-{
 	//-------------------------------------------------------
-	Mesh *createShipMesh()
+	void destroyMesh( Mesh *mesh )
 	{
-		return createMesh< ShipMesh >();
+		auto it = std::find( Mesh::meshes.begin(), Mesh::meshes.end(), mesh );
+		assert( it != Mesh::meshes.end() );
+		Mesh::meshes.erase( it );
+		delete mesh;
+	}
+
+
+	//-------------------------------------------------------
+	void placeMesh( Mesh *mesh, float x, float y, float angle )
+	{
+		mesh->place( x, y, angle );
 	}
 }
 
 
 //-------------------------------------------------------
-//	user interface: AircraftMesh support
+//	batched mesh drawing
 //-------------------------------------------------------
 
 namespace
 {
-	class AircraftMesh : public scene::Mesh
-	{
-	public:
-		void draw() override;
-		void update( float dt ) override;
+	// all visible meshes of one type are transformed on the cpu into these,
+	// then drawn with one call for triangles and one for outlines
+	std::vector< GLfloat > triangleBatch;
+	std::vector< GLfloat > lineBatch;
 
-	private:
-		float nextParticleTimeout = 0.f;
-	};
+	profiler::Counter meshDrawCallCounter( "MESH DRAW CALLS" );
 
 
-	//-------------------------------------------------------
-	void AircraftMesh::draw()
+	void appendInstance( GLfloat const *vertices, GLsizei count, float cosAngle, float sinAngle, float x, float y, std::vector< GLfloat > &batch )
 	{
-		Mesh::draw();
+		for ( GLsizei index = 0; index < count; ++index )
+		{
+			GLfloat vertexX = vertices[ 2 * index ];
+			GLfloat vertexY = vertices[ 2 * index + 1 ];
+			batch.push_back( cosAngle * vertexX - sinAngle * vertexY + x );
+			batch.push_back( sinAngle * vertexX + cosAngle * vertexY + y );
+		}
+	}
 
-		glRotatef( -90.f, 0.f, 0.f, 1.f );
 
-		glBegin( GL_TRIANGLES );
-		glColor3f( 0.5f, 0.6f, 0.1f );
-		glVertex2f( -0.06f, -0.1f );
-		glVertex2f( 0.06f, -0.1f );
-		glVertex2f( 0.f, 0.1f );
-		glVertex2f( -0.1f, -0.1f );
-		glVertex2f( 0.1f, -0.1f );
-		glVertex2f( 0.f, 0.0f );
-		glEnd();
+	int drawBatch( std::vector< GLfloat > const &batch, GLenum mode )
+	{
+		if ( batch.empty() )
+			return 0;
+		glVertexPointer( 2, GL_FLOAT, 0, batch.data() );
+		glDrawArrays( mode, 0, ( GLsizei )( batch.size() / 2 ) );
+		return 1;
+	}
 
-		glLineWidth( 2.f );
-		glBegin( GL_LINE_LOOP );
-		glColor3f( 0.8f, 1.f, 0.2f );
-		glVertex2f( -0.1f, -0.1f );
-		glVertex2f( 0.1f, -0.1f );
-		glVertex2f( 0.04f, -0.04f );
-		glVertex2f( 0.f, 0.1f );
-		glVertex2f( -0.04f, -0.04f );
-		glEnd();
+
+	// line widths shrink with the quality, but never under a pixel
+	float getLineWidth( float width )
+	{
+		return std::max( width * governor::getQuality().lineWidth, 1.f );
 	}
 
 
-	void AircraftMesh::update( float dt )
+	void drawMeshes( float halfViewWidth, float halfViewHeight )
 	{
-		nextParticleTimeout -= dt;
-		if ( nextParticleTimeout <= 0.f )
+		bool isDetailed = governor::getQuality().isDetailed;
+		int drawCallCount = 0;
+		glLoadIdentity();
+		glEnableClientState( GL_VERTEX_ARRAY );
+		for ( size_t typeIndex = 0; typeIndex < meshTypes.size(); ++typeIndex )
 		{
-			nextParticleTimeout += 0.1f;
-			addParticle( positionX, positionY, 0.8f, Color{ 1.f, 1.f, 1.f } );
+			MeshType const &type = meshTypes[ typeIndex ];
+			triangleBatch.clear();
+			lineBatch.clear();
+			for ( scene::Mesh const *mesh : scene::Mesh::meshes )
+			{
+				if ( mesh->type != ( int )typeIndex || std::abs( mesh->positionX ) > halfViewWidth + type.boundRadius ||
+					 std::abs( mesh->positionY ) > halfViewHeight + type.boundRadius )
+					continue;
+				float cosAngle = std::cos( mesh->angle );
+				float sinAngle = std::sin( mesh->angle );
+				appendInstance( type.triangleVertices, type.triangleVertexCount, cosAngle, sinAngle, mesh->positionX, mesh->positionY, triangleBatch );
+				if ( isDetailed )
+					appendInstance( type.lineVertices, type.lineVertexCount, cosAngle, sinAngle, mesh->positionX, mesh->positionY, lineBatch );
+			}
+
+			glColor3f( type.fill.r, type.fill.g, type.fill.b );
+			drawCallCount += drawBatch( triangleBatch, GL_TRIANGLES );
+			glLineWidth( getLineWidth( type.lineWidth ) );
+			glColor3f( type.line.r, type.line.g, type.line.b );
+			drawCallCount += drawBatch( lineBatch, GL_LINES );
 		}
+		glDisableClientState( GL_VERTEX_ARRAY );
+		meshDrawCallCounter.set( drawCallCount );
 	}
 }
 
+
 namespace scene
 {
 	//-------------------------------------------------------
-	Mesh *createAircraftMesh()
+	void reserveMeshes( int count )
 	{
-		return createMesh< AircraftMesh >();
+		Mesh::meshes.reserve( count );
+		int blockCount = 0;
+		for ( MeshBlock *block = freeMeshBlocks; block; block = block->next )
+			++blockCount;
+		for ( int index = ( int )Mesh::meshes.size() + blockCount; index < count; ++index )
+			Mesh::operator delete( ::operator new( sizeof( MeshBlock ) ) );
+
+		size_t batchSize = ( size_t )count * getMaximalMeshVertexCount() * 2;
+		triangleBatch.reserve( batchSize );
+		lineBatch.reserve( batchSize );
 	}
 }
 
@@ -297,7 +611,7 @@ namespace
 	void drawGoalMarker()
 	{
 		glLoadIdentity();
-		glLineWidth( 3.f );
+		glLineWidth( getLineWidth( 3.f ) );
 		glBegin( GL_LINES );
 		glColor3f( 1.0f, 0.3f, 0.2f );
 		glVertex2f( goalMarker.x - 0.1f, goalMarker.y - 0.1f );
@@ -330,6 +644,22 @@ namespace scene
 		*x = 0.5f * VIEW_WIDTH * ( 2.f * *x - 1.f );
 		*y = 0.5f * VIEW_HEIGHT * ( 2.f * *y - 1.f );
 	}
+
+
+	void shiftOrigin( float x, float y )
+	{
+		for ( Mesh *mesh : Mesh::meshes )
+			mesh->shift( x, y );
+		for ( Particle &particle : particles )
+		{
+			particle.x -= x;
+			particle.y -= y;
+		}
+		goalMarker.x -= x;
+		goalMarker.y -= y;
+		seaOriginX += x;
+		seaOriginY += y;
+	}
 }
 
 
@@ -337,38 +667,37 @@ namespace scene
 //	engine only interface
 //-------------------------------------------------------
 
+namespace
+{
+	profiler::Counter meshCounter( "MESHES" );
+	profiler::Counter particleCounter( "PARTICLES" );
+}
+
+
 namespace scene
 {
-	namespace
+	void beginStep()
 	{
-		constexpr float TIME_BETWEEN_SEA_PARTICLES = 0.02f;
-		float timeToNextSeaParticle = 0.f;
-		std::default_random_engine seaParticlesRandomEngine( 42 );
-		std::uniform_real_distribution< float > seaParticlesHorizDistr( -0.5f * VIEW_WIDTH, 0.5f * VIEW_WIDTH );
-		std::uniform_real_distribution< float > seaParticlesVertDistr( -0.5f * VIEW_HEIGHT, 0.5f * VIEW_HEIGHT );
+		++Mesh::step;
 	}
 
 
 	void update( float dt )
 	{
+		// trails run on a clock slowed down by the quality, a stopped one emits nothing
+		float trailDt = dt * governor::getQuality().trailRate;
 		for ( Mesh *mesh : Mesh::meshes )
-			mesh->update( dt );
+			mesh->update( trailDt );
 		updateParticles( dt );
-
-		timeToNextSeaParticle += dt;
-		while ( timeToNextSeaParticle > 0.f )
-		{
-			timeToNextSeaParticle -= TIME_BETWEEN_SEA_PARTICLES;
-			addParticle( seaParticlesHorizDistr( seaParticlesRandomEngine ),
-						 seaParticlesVertDistr( seaParticlesRandomEngine ),
-						 3.f,
-						 Color{ 0.15f, 0.3f, 0.6f } );
-		}
+		seaTime += dt;
 	}
 
 
-	void draw()
+	void draw( float stepFraction )
 	{
+		for ( Mesh *mesh : Mesh::meshes )
+			mesh->interpolate( stepFraction );
+
 		glMatrixMode( GL_PROJECTION );
 		glLoadIdentity();
 		glScalef( 2.f / VIEW_WIDTH, 2.f / VIEW_HEIGHT, 0.f );
@@ -378,9 +707,13 @@ namespace scene
 		glClear( GL_COLOR_BUFFER_BIT );
 		glMatrixMode( GL_MODELVIEW );
 
+		drawSeaParticles( -0.5f * VIEW_WIDTH, -0.5f * VIEW_HEIGHT, 0.5f * VIEW_WIDTH, 0.5f * VIEW_HEIGHT, governor::getQuality().seaSlotStride );
 		drawParticles();
-		for ( Mesh *mesh : Mesh::meshes )
-			mesh->draw();
+		drawMeshes( 0.5f * VIEW_WIDTH, 0.5f * VIEW_HEIGHT );
 		drawGoalMarker();
+
+		meshCounter.set( ( int64_t )Mesh::meshes.size() );
+		particleCounter.set( ( int64_t )particles.size() );
+		hud::draw();
 	}
 }
@@ -8,12 +8,16 @@ namespace scene
 {
 	class Mesh;
 
-	Mesh *createShipMesh();
-	Mesh *createAircraftMesh();
+	// typeName is a mesh of meshes.wsm, or of the built-in meshes without that file
+	Mesh *createMesh( char const *typeName );
 	void destroyMesh( Mesh *mesh );
+	// up to count meshes may then exist at once without allocating
+	void reserveMeshes( int count );
 	void placeMesh( Mesh *mesh, float x, float y, float angle );
 
 	void screenToWorld( float *x, float *y );
+	// moves everything by ( -x, -y ), the game calls it when its floating origin moves
+	void shiftOrigin( float x, float y );
 
 	void placeGoalMarker( float x, float y );
 }
@@ -25,6 +29,10 @@ namespace scene
 
 namespace scene
 {
+	// called before every fixed simulation step, meshes placed during the step
+	// are drawn moving from their previous pose to the placed one
+	void beginStep();
 	void update( float dt );
-	void draw();
+	// stepFraction in [0; 1) is the part of the next simulation step already elapsed
+	void draw( float stepFraction );
 }
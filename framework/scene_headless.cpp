@@ -0,0 +1,126 @@
+#include <cassert>
+
+#include "profiler.hpp"
+#include "scene.hpp"
+
+
+//-------------------------------------------------------
+//	headless scene: same interface as scene.cpp without
+//	window and opengl, used by offline simulation tools.
+//	Drawing stands for presenting, so tools feeding input
+//	through profiler::inputReceived get latency timings
+//-------------------------------------------------------
+
+namespace scene
+{
+	constexpr float VIEW_WIDTH = 18.f;
+	constexpr float VIEW_HEIGHT = 13.5f;
+
+
+	// meshes carry no state here, so simulations may run on several threads at once
+	class Mesh
+	{
+	public:
+		Mesh *nextFree = nullptr;
+	};
+
+
+	// destroyed meshes are reused like the pooled ones of scene.cpp, so
+	// allocation checks give the same answer in headless runs
+	struct MeshPool
+	{
+		Mesh *freeMeshes = nullptr;
+
+		~MeshPool()
+		{
+			while ( freeMeshes )
+			{
+				Mesh *next = freeMeshes->nextFree;
+				delete freeMeshes;
+				freeMeshes = next;
+			}
+		}
+	};
+
+	thread_local MeshPool meshPool;
+
+
+	//-------------------------------------------------------
+	Mesh *createMesh( char const *typeName )
+	{
+		Mesh *mesh = meshPool.freeMeshes;
+		if ( !mesh )
+			return new Mesh;
+		meshPool.freeMeshes = mesh->nextFree;
+		mesh->nextFree = nullptr;
+		return mesh;
+	}
+
+
+	//-------------------------------------------------------
+	void destroyMesh( Mesh *mesh )
+	{
+		assert( mesh );
+		mesh->nextFree = meshPool.freeMeshes;
+		meshPool.freeMeshes = mesh;
+	}
+
+
+	//-------------------------------------------------------
+	void reserveMeshes( int count )
+	{
+		// the game reserves once at start, live meshes are not counted here
+		int freeCount = 0;
+		for ( Mesh *mesh = meshPool.freeMeshes; mesh; mesh = mesh->nextFree )
+			++freeCount;
+		for ( ; freeCount < count; ++freeCount )
+			destroyMesh( new Mesh );
+	}
+
+
+	//-------------------------------------------------------
+	void placeMesh( Mesh *mesh, float x, float y, float angle )
+	{
+		assert( mesh );
+	}
+
+
+	//-------------------------------------------------------
+	void screenToWorld( float *x, float *y )
+	{
+		*x = 0.5f * VIEW_WIDTH * ( 2.f * *x - 1.f );
+		*y = 0.5f * VIEW_HEIGHT * ( 2.f * *y - 1.f );
+	}
+
+
+	//-------------------------------------------------------
+	void shiftOrigin( float x, float y )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void placeGoalMarker( float x, float y )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void beginStep()
+	{
+		profiler::stepStarted();
+	}
+
+
+	//-------------------------------------------------------
+	void update( float dt )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void draw( float stepFraction )
+	{
+		profiler::framePresented();
+	}
+}
@@ -0,0 +1,218 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+#include "shared_memory.hpp"
+
+
+//-------------------------------------------------------
+//	platform independent part
+//-------------------------------------------------------
+
+SharedMemory::~SharedMemory()
+{
+	close();
+}
+
+
+//-------------------------------------------------------
+bool SharedMemory::isOpen() const
+{
+	return data != nullptr;
+}
+
+
+//-------------------------------------------------------
+uint8_t *SharedMemory::getData() const
+{
+	return data;
+}
+
+
+//-------------------------------------------------------
+size_t SharedMemory::getSize() const
+{
+	return size;
+}
+
+
+#ifdef _WIN32
+
+//-------------------------------------------------------
+//	windows mapping backed by the page file
+//-------------------------------------------------------
+
+namespace
+{
+	// session local, no privilege needed
+	void makeMappingName( char const *name, char *mappingName, size_t capacity )
+	{
+		std::snprintf( mappingName, capacity, "Local\\%s", name );
+	}
+}
+
+
+//-------------------------------------------------------
+bool SharedMemory::create( char const *name, size_t regionSize )
+{
+	close();
+
+	char mappingName[ 256 ];
+	makeMappingName( name, mappingName, sizeof( mappingName ) );
+	uint64_t size64 = regionSize;
+	HANDLE mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+										 ( DWORD )( size64 >> 32 ), ( DWORD )size64, mappingName );
+	if ( !mapping )
+		return false;
+	// readers of a previous run may still hold the old region, it is reused when large enough
+	bool isExisting = GetLastError() == ERROR_ALREADY_EXISTS;
+
+	void *view = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, regionSize );
+	if ( !view )
+	{
+		CloseHandle( mapping );
+		return false;
+	}
+	if ( isExisting )
+		std::memset( view, 0, regionSize );
+
+	mappingHandle = mapping;
+	data = static_cast< uint8_t * >( view );
+	size = regionSize;
+	isOwner = true;
+	return true;
+}
+
+
+//-------------------------------------------------------
+bool SharedMemory::open( char const *name )
+{
+	close();
+
+	char mappingName[ 256 ];
+	makeMappingName( name, mappingName, sizeof( mappingName ) );
+	HANDLE mapping = OpenFileMappingA( FILE_MAP_READ, FALSE, mappingName );
+	if ( !mapping )
+		return false;
+
+	void *view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	MEMORY_BASIC_INFORMATION information;
+	if ( !view || VirtualQuery( view, &information, sizeof( information ) ) == 0 )
+	{
+		if ( view )
+			UnmapViewOfFile( view );
+		CloseHandle( mapping );
+		return false;
+	}
+
+	mappingHandle = mapping;
+	data = static_cast< uint8_t * >( view );
+	// rounded up to whole pages, the region header tells the real size
+	size = information.RegionSize;
+	isOwner = false;
+	return true;
+}
+
+
+//-------------------------------------------------------
+void SharedMemory::close()
+{
+	if ( !data )
+		return;
+	UnmapViewOfFile( data );
+	CloseHandle( mappingHandle );
+	data = nullptr;
+	size = 0;
+	isOwner = false;
+	mappingHandle = nullptr;
+}
+
+#else
+
+//-------------------------------------------------------
+//	posix shared memory
+//-------------------------------------------------------
+
+bool SharedMemory::create( char const *name, size_t regionSize )
+{
+	close();
+
+	std::snprintf( path, sizeof( path ), "/%s", name );
+	shm_unlink( path );
+	int handle = shm_open( path, O_CREAT | O_EXCL | O_RDWR, 0644 );
+	if ( handle < 0 )
+		return false;
+	if ( ftruncate( handle, ( off_t )regionSize ) != 0 )
+	{
+		::close( handle );
+		shm_unlink( path );
+		return false;
+	}
+
+	void *view = mmap( nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0 );
+	// mapping stays valid after the descriptor is closed
+	::close( handle );
+	if ( view == MAP_FAILED )
+	{
+		shm_unlink( path );
+		return false;
+	}
+
+	data = static_cast< uint8_t * >( view );
+	size = regionSize;
+	isOwner = true;
+	return true;
+}
+
+
+//-------------------------------------------------------
+bool SharedMemory::open( char const *name )
+{
+	close();
+
+	std::snprintf( path, sizeof( path ), "/%s", name );
+	int handle = shm_open( path, O_RDONLY, 0 );
+	if ( handle < 0 )
+		return false;
+
+	struct stat status;
+	if ( fstat( handle, &status ) != 0 || status.st_size == 0 )
+	{
+		::close( handle );
+		return false;
+	}
+
+	void *view = mmap( nullptr, ( size_t )status.st_size, PROT_READ, MAP_SHARED, handle, 0 );
+	::close( handle );
+	if ( view == MAP_FAILED )
+		return false;
+
+	data = static_cast< uint8_t * >( view );
+	size = ( size_t )status.st_size;
+	isOwner = false;
+	return true;
+}
+
+
+//-------------------------------------------------------
+void SharedMemory::close()
+{
+	if ( !data )
+		return;
+	munmap( data, size );
+	if ( isOwner )
+		shm_unlink( path );
+	data = nullptr;
+	size = 0;
+	isOwner = false;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	named memory region shared between local processes,
+//	one process creates it writable, any number of others
+//	map it read only. Named file mapping on windows,
+//	shm_open elsewhere
+//-------------------------------------------------------
+
+class SharedMemory
+{
+public:
+	SharedMemory() = default;
+	~SharedMemory();
+
+	SharedMemory( SharedMemory const & ) = delete;
+	SharedMemory &operator=( SharedMemory const & ) = delete;
+
+	// new zero filled region, replaces a stale one left by a crashed owner
+	bool create( char const *name, size_t size );
+	// existing region, read only
+	bool open( char const *name );
+	// the owner removes the name, mappings of readers stay valid until they close
+	void close();
+
+	bool isOpen() const;
+	uint8_t *getData() const;
+	size_t getSize() const;
+
+private:
+	uint8_t *data = nullptr;
+	size_t size = 0;
+	bool isOwner = false;
+#ifdef _WIN32
+	void *mappingHandle = nullptr;
+#else
+	char path[ 64 ] = {};
+#endif
+};
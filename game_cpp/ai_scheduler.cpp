@@ -0,0 +1,96 @@
+#include "ai_scheduler.h"
+#include "supporting_function.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+AIThinker::~AIThinker()
+{
+}
+
+AIScheduler::AIScheduler() :
+	_time(0.0),
+	_frames(0),
+	_thinks(0),
+	_latencySum(0.0),
+	_maximalLatency(0.f),
+	_budgetShareSum(0.0),
+	_maximalBudgetShare(0.f)
+{
+}
+
+void AIScheduler::add(AIThinker* thinker) {
+	assert(thinker);
+	_queue.push_back(Entry{ _time, thinker });
+	std::push_heap(_queue.begin(), _queue.end(), _isLater);
+}
+
+void AIScheduler::remove(AIThinker* thinker) {
+	auto newEnd = std::remove_if(_queue.begin(), _queue.end(), [thinker](Entry const& entry) { return entry.thinker == thinker; });
+	_queue.erase(newEnd, _queue.end());
+	std::make_heap(_queue.begin(), _queue.end(), _isLater);
+}
+
+void AIScheduler::clear() {
+	_queue.clear();
+}
+
+void AIScheduler::update(float dt) {
+	typedef std::chrono::steady_clock Clock;
+
+	_time += dt;
+	_frames++;
+
+	Clock::time_point frameStart = Clock::now();
+	float spentMicroseconds = 0.f;
+	int thinks = 0;
+
+	while (!_queue.empty() && _queue.front().dueTime <= _time && thinks < params::ai::MAX_THINKS_PER_FRAME) {
+#ifndef WOTS_DETERMINISTIC
+		//Lockstep peers must think at the same frames, so only the count limit applies to them
+		if (thinks > 0 && spentMicroseconds >= params::ai::THINK_BUDGET_MICROSECONDS) {
+			break;
+		}
+#endif
+		std::pop_heap(_queue.begin(), _queue.end(), _isLater);
+		Entry& entry = _queue.back();
+
+		float latency = (float)(_time - entry.dueTime);
+		_latencySum += latency;
+		_maximalLatency = std::max(_maximalLatency, latency);
+
+		entry.thinker->think();
+		entry.dueTime = _time + entry.thinker->getThinkInterval();
+		std::push_heap(_queue.begin(), _queue.end(), _isLater);
+
+		thinks++;
+		spentMicroseconds = std::chrono::duration<float, std::micro>(Clock::now() - frameStart).count();
+	}
+
+	float budgetShare = spentMicroseconds / params::ai::THINK_BUDGET_MICROSECONDS;
+	_thinks += thinks;
+	_budgetShareSum += budgetShare;
+	_maximalBudgetShare = std::max(_maximalBudgetShare, budgetShare);
+}
+
+AIScheduler::Stats AIScheduler::takeStats() {
+	Stats stats;
+	stats.thinks = _thinks;
+	stats.averageLatency = _thinks > 0 ? (float)(_latencySum / _thinks) : 0.f;
+	stats.maximalLatency = _maximalLatency;
+	stats.averageBudgetShare = _frames > 0 ? (float)(_budgetShareSum / _frames) : 0.f;
+	stats.maximalBudgetShare = _maximalBudgetShare;
+
+	_frames = 0;
+	_thinks = 0;
+	_latencySum = 0.0;
+	_maximalLatency = 0.f;
+	_budgetShareSum = 0.0;
+	_maximalBudgetShare = 0.f;
+	return stats;
+}
+
+bool AIScheduler::_isLater(Entry const& first, Entry const& second) {
+	return first.dueTime > second.dueTime;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+
+//-------------------------------------------------------
+//	Time-sliced scheduler for AI decision making.
+//	Every thinker is due after its own interval, due thinkers run
+//	oldest first until the per-frame budget is spent, the rest
+//	wait for the next frame.
+//-------------------------------------------------------
+
+class AIThinker
+{
+public:
+	virtual ~AIThinker();
+	virtual void think() = 0;
+	//Shorter interval gives higher priority, asked after every think
+	virtual float getThinkInterval() = 0;
+};
+
+class AIScheduler
+{
+public:
+	struct Stats
+	{
+		int thinks;
+		//Delay between the moment a thinker became due and its think
+		float averageLatency;
+		float maximalLatency;
+		//Share of the per-frame budget spent on thinking
+		float averageBudgetShare;
+		float maximalBudgetShare;
+	};
+
+	AIScheduler();
+	void add(AIThinker* thinker);
+	void remove(AIThinker* thinker);
+	void clear();
+	void update(float dt);
+
+	//Statistics accumulated since the previous call
+	Stats takeStats();
+
+private:
+	struct Entry
+	{
+		double dueTime;
+		AIThinker* thinker;
+	};
+
+	static bool _isLater(Entry const& first, Entry const& second);
+
+	std::vector<Entry> _queue;
+	double _time;
+
+	int _frames;
+	int _thinks;
+	double _latencySum;
+	float _maximalLatency;
+	double _budgetShareSum;
+	float _maximalBudgetShare;
+};
@@ -1,146 +1,334 @@
 #include "aircraft.h"
 #include "ship.h"
+#include "deterministic_math.h"
 #include <cassert>
 #include <cmath>
 #include <algorithm>
 
+namespace
+{
+	//Share of the spare flight time an aircraft may skip before checking the return condition
+	//again, the rest covers float rounding
+	constexpr float RETURN_CHECK_SAFETY_FACTOR = 0.9f;
+	//Relative deviations of distance and speed, and the radial share of the heading,
+	//under which a patrolling aircraft is taken for holding its orbit
+	constexpr float ORBIT_RADIUS_TOLERANCE = 0.01f;
+	constexpr float ORBIT_SPEED_TOLERANCE = 0.02f;
+	constexpr float ORBIT_RADIAL_HEADING_TOLERANCE = 0.05f;
+}
+
 Aircraft::Aircraft(Ship& mothership) :
 	_mesh(nullptr),
+	_collisionProxy(collision::NO_PROXY),
+	_transform(transforms::NO_TRANSFORM),
 	_mothership(mothership),
 	_status(AircraftStatus::ReadyToFlight),
-	_flightTime(0.f)
+	_flightTime(0.f),
+	_returnCheckTime(0.f),
+	_obstacle(getOpenWaterSample()),
+	_isOnOrbit(false),
+	_isAsleep(false),
+	_evaluatedClock(-1.f)
 {
 }
 
 void Aircraft::init() {
 	_position = Vector2(0.f, 0.f);
 	_angle = 0.f;
+	_rotation = Rotation2();
+	_turnAngle = 0.f;
+	_turn = Rotation2();
 	_speed = 0.f;
+	_distanceToShip = 0.f;
+	_isOnOrbit = false;
+	_isAsleep = false;
+	_evaluatedClock = -1.f;
 }
 
 void Aircraft::deinit()
 {
 	if (_mesh != NULL) {
+		transforms::destroy(_transform);
+		_transform = transforms::NO_TRANSFORM;
 		scene::destroyMesh(_mesh);
 		_mesh = nullptr;
+		collision::destroyProxy(_collisionProxy);
+		_collisionProxy = collision::NO_PROXY;
 	}
 	_status = ReadyToFlight;
+	_isAsleep = false;
 }
 
 bool Aircraft::Takeoff()
 {
 	if (_status == ReadyToFlight) {
 		assert(!_mesh);
-		_mesh = scene::createAircraftMesh();
+		_mesh = scene::createMesh(params::aircraft::MESH_NAME);
+		_transform = transforms::create(_mesh);
 		_position = _mothership.getPosition();
 		_distanceToShip = 0.f;
 		_angle = _mothership.getAngle();
-		scene::placeMesh(_mesh, _position.x, _position.y, _angle);
+		_rotation = _mothership.getRotation();
+		_collisionProxy = collision::createProxy(collision::AircraftBody, this, &_mothership);
+		_returnCheckTime = 0.f;
+		_obstacle = getOpenWaterSample();
+		_isOnOrbit = false;
 		_status = TakeOff;
+		_boardDeck();
+		_placeBody();
 		return true;
 	}
 	return false;
 }
 
-void Aircraft::update(float dt) {
+AircraftStatus Aircraft::updateTakeOff(float dt) {
 	_flightTime += dt;
-	float acceleration = 0.f;
-	float deltaAngle = 0.f;
+	_status = _updateTakeOff(dt);
+	return _status;
+}
 
-	switch (_status) {
-	case ReadyToFlight: {
-		_flightTime = 0;
-		return;
-		break;
-	}
-	case TakeOff: {
-		acceleration = params::aircraft::LINEAR_ACCELERATION;
-		float deltaSpeed = _getDeltaSpeed(params::aircraft::LINEAR_ACCELERATION, dt, params::aircraft::TAKEOFF_SPEED_COEFICIENT * params::aircraft::LINEAR_SPEED);
-		
-		_angle = _mothership.getAngle();
-		_distanceToShip = _distanceToShip + _speed * dt + deltaSpeed * dt * 0.5f;
-		_position = _mothership.getPosition() + _distanceToShip * Vector2(std::cos(_angle), std::sin(_angle));
-		_speed += deltaSpeed;
+AircraftStatus Aircraft::updateLayInACourse(float dt) {
+	_flightTime += dt;
+	_status = _updateLayInACourse(dt);
+	return _status;
+}
 
-		scene::placeMesh(_mesh, _position.x, _position.y, _angle);
+AircraftStatus Aircraft::updateReturning(float dt) {
+	_flightTime += dt;
+	_status = _updateReturning(dt);
+	return _status;
+}
 
-		if (_isReturningTime()) {
-			_status = Returning;
-			break;
-		}
-		if (_isTakeOffFinished()) {
-			_status = LayInACourse;
-		}
-		break;
+AircraftStatus Aircraft::updateFuelling(float dt) {
+	_flightTime += dt;
+	_status = _updateFuelling(dt);
+	return _status;
+}
+
+AircraftStatus Aircraft::_updateTakeOff(float dt) {
+	float deltaSpeed = _getDeltaSpeed(params::aircraft::LINEAR_ACCELERATION, dt, params::aircraft::TAKEOFF_SPEED_COEFICIENT * params::aircraft::LINEAR_SPEED);
+
+	_angle = _mothership.getAngle();
+	_rotation = _mothership.getRotation();
+	_distanceToShip = _distanceToShip + _speed * dt + deltaSpeed * dt * 0.5f;
+	//The deck runs along the mothership heading
+	Vector2 deckPosition(_distanceToShip, 0.f);
+	_position = Transform2(_mothership.getPosition(), _rotation).apply(deckPosition);
+	_speed += deltaSpeed;
+
+	_placeBody();
+
+	if (_isTakeOffFinished()) {
+		_leaveDeck();
+		return LayInACourse;
 	}
-	case LayInACourse: {
-		bool isSuccess; 
+	return TakeOff;
+}
 
-		if (_isOnCourse()) {
-			float patrolSpeed = params::aircraft::LINEAR_SPEED * params::aircraft::PATROL_SPEED_COEFFICIENT;
-			acceleration = _getAcceleration(_target, patrolSpeed, dt);
-		}
+AircraftStatus Aircraft::_updateLayInACourse(float dt) {
+	if (_isOnOrbit) {
+		_updateOrbit(dt);
+		return LayInACourse;
+	}
 
-		changeInternalState(acceleration, _getLayInACourseDeltaAngle(dt), dt);
+	//Course angle is needed both for acceleration and for turn, so it is computed once
+	bool isSuccess;
+	float relativePatrolAngle = _getRelativePatrolAngle(params::aircraft::PATROL_RADIUS, &isSuccess);
 
-		scene::placeMesh(_mesh, _position.x, _position.y, _angle);
+	float acceleration = 0.f;
+	if (_isOnCourse(relativePatrolAngle, isSuccess)) {
+		float patrolSpeed = params::aircraft::LINEAR_SPEED * params::aircraft::PATROL_SPEED_COEFFICIENT;
+		acceleration = _getAcceleration(_target, patrolSpeed, dt);
+	}
 
-		if (_isReturningTime()) {
-			_status = Returning;
-			break;
-		}
-		break; 
-	}
-	case Returning: {
-		Vector2 vectorToMothership = _mothership.getPosition() - _position;
-		Vector2 angleVector(cos(_angle), sin(_angle));
-
-		float returnSpeed = std::min(params::ship::LINEAR_SPEED * params::aircraft::LANDING_SPEED_COEFFICIENT, params::aircraft::LINEAR_SPEED* 1.f);
-		acceleration = _getAcceleration(_mothership.getPosition(), returnSpeed, dt);
-		
-		float relativePatrolAngle = _getVectorsAngleDistance(atan2(vectorToMothership.y, vectorToMothership.x), _angle);
-		if (abs(relativePatrolAngle) <= params::aircraft::ANGULAR_SPEED * dt) {
-			deltaAngle = relativePatrolAngle;
-		}
-		else {
-			deltaAngle = sign(relativePatrolAngle) * (params::aircraft::ANGULAR_SPEED * dt);
-		}
+	changeInternalState(acceleration, _getTurnDeltaAngle(_getObstacleAvoidingAngle(relativePatrolAngle), dt), dt);
 
-		changeInternalState(acceleration, deltaAngle, dt);
+	_placeBody();
 
-		scene::placeMesh(_mesh, _position.x, _position.y, _angle);
-		
-		if (_isAircraftNearTheMothership()) {
-			_status = Fuelling;
-			scene::destroyMesh(_mesh);
-			_mesh = nullptr;
-		}
-		break;
+	if (_isOrbitSteady()) {
+		_enterOrbit();
 	}
-	case Fuelling: {
-		_flightTime -= dt * (params::ship::FUELLING_COEFFICIENT + 1);
-		if (_flightTime < 0) {
-			_flightTime = 0;
-			_status = ReadyToFlight;
-		}
+	return LayInACourse;
+}
+
+void Aircraft::_updateOrbit(float dt) {
+	_orbitTime += dt;
+	_setOrbitPose();
+	_placeBody();
+}
+
+void Aircraft::_setOrbitPose() {
+	float phase = _orbitStartPhase + _orbitAngularSpeed * _orbitTime;
+	Rotation2 radial = rotationFromAngle(phase);
+	float turnSign = (float)sign(_orbitAngularSpeed);
+	_position = _target + _orbitRadius * radial.getDirection();
+	//Heading is a quarter turn from the radius in the orbit direction
+	_rotation = radial * Rotation2(0.f, turnSign);
+	_angle = dmath::fmod(phase + turnSign * 0.5f * params::precision::PI_CONST, 2 * params::precision::PI_CONST);
+}
+
+void Aircraft::_evaluateSleep() {
+	float clock = _mothership.getAircraftClock();
+	if (!_isAsleep || clock == _evaluatedClock) {
 		return;
-		break;
 	}
+	float elapsed = clock - _sleepClock;
+	_flightTime = _sleepFlightTime + elapsed;
+	_orbitTime = _sleepOrbitTime + elapsed;
+	_setOrbitPose();
+	_evaluatedClock = clock;
+}
+
+bool Aircraft::_isOrbitSteady() {
+	//Shores bend the course, so only open water orbits are flown on rails. A sleeping aircraft
+	//isn't sensed, so every point of the orbit, at most its diameter away, must be clear
+	if (_obstacle.distance < params::aircraft::OBSTACLE_AVOID_DISTANCE + 2.f * params::aircraft::PATROL_RADIUS) {
+		return false;
+	}
+	float patrolSpeed = params::aircraft::LINEAR_SPEED * params::aircraft::PATROL_SPEED_COEFFICIENT;
+	if (patrolSpeed > params::aircraft::ANGULAR_SPEED * params::aircraft::PATROL_RADIUS) {
+		return false;
+	}
+	if (std::abs(_speed - patrolSpeed) > ORBIT_SPEED_TOLERANCE * patrolSpeed) {
+		return false;
+	}
+	Vector2 radial = _position - _target;
+	float distance = dmath::sqrt(radial.lengthSquare());
+	if (std::abs(distance - params::aircraft::PATROL_RADIUS) > ORBIT_RADIUS_TOLERANCE * params::aircraft::PATROL_RADIUS) {
+		return false;
+	}
+	Vector2 heading = _rotation.getDirection();
+	return std::abs(heading.x * radial.x + heading.y * radial.y) <= ORBIT_RADIAL_HEADING_TOLERANCE * distance;
+}
+
+void Aircraft::_enterOrbit() {
+	Vector2 radial = _position - _target;
+	Vector2 heading = _rotation.getDirection();
+	float patrolSpeed = params::aircraft::LINEAR_SPEED * params::aircraft::PATROL_SPEED_COEFFICIENT;
+	_orbitRadius = dmath::sqrt(radial.lengthSquare());
+	_orbitStartPhase = dmath::atan2(radial.y, radial.x);
+	_orbitAngularSpeed = (radial.x * heading.y - radial.y * heading.x >= 0.f ? patrolSpeed : -patrolSpeed) / _orbitRadius;
+	_orbitTime = 0.f;
+	_speed = patrolSpeed;
+	_isOnOrbit = true;
+}
+
+AircraftStatus Aircraft::_updateReturning(float dt) {
+	Vector2 vectorToMothership = _mothership.getPosition() - _position;
+	Vector2 startOffset = _position - _mothership.getStepStartPosition();
+
+	float returnSpeed = std::min(params::ship::LINEAR_SPEED * params::aircraft::LANDING_SPEED_COEFFICIENT, params::aircraft::LINEAR_SPEED* 1.f);
+	float acceleration = _getAcceleration(_mothership.getPosition(), returnSpeed, dt);
+
+	float relativePatrolAngle = _getVectorsAngleDistance(dmath::atan2(vectorToMothership.y, vectorToMothership.x), _angle);
+	changeInternalState(acceleration, _getTurnDeltaAngle(relativePatrolAngle, dt), dt);
+
+	_placeBody();
+
+	if (_isAircraftNearTheMothership(startOffset)) {
+		transforms::destroy(_transform);
+		_transform = transforms::NO_TRANSFORM;
+		scene::destroyMesh(_mesh);
+		_mesh = nullptr;
+		collision::destroyProxy(_collisionProxy);
+		_collisionProxy = collision::NO_PROXY;
+		return Fuelling;
+	}
+	return Returning;
+}
+
+AircraftStatus Aircraft::_updateFuelling(float dt) {
+	_flightTime -= dt * (params::ship::FUELLING_COEFFICIENT + 1);
+	if (_flightTime < 0) {
+		_flightTime = 0;
+		return ReadyToFlight;
 	}
+	return Fuelling;
 }
 
 void Aircraft::setTarget(Vector2 target) {
+	assert(!_isAsleep && "the mothership wakes aircraft before retargeting them");
 	if (_status != Returning) {
 		_target = target;
+		_isOnOrbit = false;
 		if ((_status != Fuelling) && (_status !=ReadyToFlight) && (_status != TakeOff)) {
 			_status = LayInACourse;
 		}
 	}
 }
 
+AircraftStatus Aircraft::getStatus() {
+	return _status;
+}
+
+float Aircraft::getFlightTime() {
+	_evaluateSleep();
+	return _flightTime;
+}
+
+Vector2 Aircraft::getPosition() {
+	_evaluateSleep();
+	return _position;
+}
+
+Vector2 Aircraft::getTarget() {
+	return _target;
+}
+
+float Aircraft::getSpeed() {
+	return _speed;
+}
+
+float Aircraft::getAngle() {
+	_evaluateSleep();
+	return _angle;
+}
+
+uint32_t Aircraft::hashState(uint32_t hash) {
+	_evaluateSleep();
+	hash = dmath::hashBytes(hash, &_position.x, sizeof(_position.x));
+	hash = dmath::hashBytes(hash, &_position.y, sizeof(_position.y));
+	hash = dmath::hashBytes(hash, &_speed, sizeof(_speed));
+	hash = dmath::hashBytes(hash, &_angle, sizeof(_angle));
+	hash = dmath::hashBytes(hash, &_flightTime, sizeof(_flightTime));
+	hash = dmath::hashBytes(hash, &_distanceToShip, sizeof(_distanceToShip));
+	hash = dmath::hashBytes(hash, &_target.x, sizeof(_target.x));
+	hash = dmath::hashBytes(hash, &_target.y, sizeof(_target.y));
+	int32_t status = _status;
+	return dmath::hashBytes(hash, &status, sizeof(status));
+}
+
+void Aircraft::_placeBody() {
+	if (_status == TakeOff) {
+		transforms::setLocal(_transform, Vector2(_distanceToShip, 0.f), 0.f);
+	}
+	else {
+		transforms::set(_transform, _position, _angle);
+	}
+	collision::moveProxy(_collisionProxy, Transform2(_position, _rotation));
+}
+
+void Aircraft::_boardDeck() {
+	transforms::setParent(_transform, _mothership.getTransform());
+}
+
+void Aircraft::_leaveDeck() {
+	transforms::setParent(_transform, transforms::NO_TRANSFORM);
+	transforms::set(_transform, _position, _angle);
+}
+
 void Aircraft::changeInternalState(float acceleration, float deltaAngle, float dt) {
-	_angle = fmod(_angle + deltaAngle, 2 * params::precision::PI_CONST);
-	_position = _position + (_speed * dt + acceleration * pow(dt, 2) * 0.5f) * Vector2(std::cos(_angle), std::sin(_angle));
+	//Heading turns evenly during the step, so the aircraft flies the arc and not the chord, exact for any dt
+	_position = _position + _rotation.rotate(getArcDisplacement(_speed, acceleration, deltaAngle, dt));
+	float angle = dmath::fmod(_angle + deltaAngle, 2 * params::precision::PI_CONST);
+	if (angle != _angle) {
+		_angle = angle;
+		if (deltaAngle != _turnAngle) {
+			_turnAngle = deltaAngle;
+			_turn = rotationFromAngle(deltaAngle);
+		}
+		_rotation = composeTurn(_rotation, _turn, angle);
+	}
 	_speed = _speed + acceleration * dt;
 }
 
@@ -148,19 +336,189 @@ bool Aircraft::_isTakeOffFinished() {
 	return params::aircraft::TAKEOFF_RADIUS < _distanceToShip;
 }
 
-bool Aircraft::_isReturningTime() {
-	assert(params::aircraft::LINEAR_SPEED > params::ship::LINEAR_SPEED);
-	float timeForReturning = _timeForMakingCircle() + _timeForReturning() + _timeForLanding();
-	return _flightTime + timeForReturning  > params::aircraft::MAXIMAL_FLIGHT_TIME;
+bool Aircraft::isReturnCheckDue() {
+	return (_status == TakeOff || _status == LayInACourse) && _flightTime >= _returnCheckTime;
+}
+
+void Aircraft::addReturnCheck(ReturnCostBatch& batch) {
+	Vector2 lineOfSight = _mothership.getPosition() - _position;
+	Vector2 heading = _rotation.getDirection();
+	Vector2 shipHeading = _mothership.getRotation().getDirection();
+	float bearing = dmath::atan2(heading.x * lineOfSight.y - heading.y * lineOfSight.x, heading.x * lineOfSight.x + heading.y * lineOfSight.y);
+	float axisAngle = dmath::atan2(shipHeading.x * lineOfSight.y - shipHeading.y * lineOfSight.x, shipHeading.x * lineOfSight.x + shipHeading.y * lineOfSight.y);
+	batch.add(dmath::sqrt(lineOfSight.lengthSquare()), bearing, axisAngle);
+}
+
+void Aircraft::finishReturnCheck(float returnTime) {
+	float timeForReturning = returnTime + _timeForAccelerating() + _timeForLanding();
+	if (_flightTime + timeForReturning > params::aircraft::MAXIMAL_FLIGHT_TIME) {
+		//A check due right at launch turns back an aircraft still rolling along the deck
+		if (_status == TakeOff) {
+			_leaveDeck();
+		}
+		_isOnOrbit = false;
+		_status = Returning;
+		return;
+	}
+	//The table bound grows with distance only, and the distance to the mothership by at most
+	//the sum of both speeds, so the answer can't change until the spare time is eaten up at that rate.
+	//Slowing down costs at most the acceleration from a standstill
+	float maximalAircraftSpeed = std::max(params::aircraft::LINEAR_SPEED, params::aircraft::TAKEOFF_SPEED_COEFICIENT * params::aircraft::LINEAR_SPEED);
+	float maximalShipSpeed = params::ship::LINEAR_SPEED + params::world::MAXIMAL_SEA_CURRENT;
+	float maximalGrowthRate = 1.f + (maximalAircraftSpeed + maximalShipSpeed) * getReturnTimeBoundSlope();
+	float maximalAccelerationTime = 0.5f * params::aircraft::LINEAR_SPEED / params::aircraft::LINEAR_ACCELERATION;
+	float distance = dmath::sqrt((_mothership.getPosition() - _position).lengthSquare());
+	float timeBound = getReturnTimeBound(distance) + maximalAccelerationTime + _timeForLanding();
+	float spareTime = params::aircraft::MAXIMAL_FLIGHT_TIME - _flightTime - timeBound;
+	_returnCheckTime = _flightTime + RETURN_CHECK_SAFETY_FACTOR * spareTime / maximalGrowthRate;
+}
+
+void Aircraft::recheckReturningTime() {
+	assert(!_isAsleep);
+	_returnCheckTime = 0.f;
+}
+
+void Aircraft::advanceReturnCheck(float time) {
+	assert(_isAsleep);
+	_returnCheckTime -= time;
+	_wakeClock -= time;
+}
+
+void Aircraft::setObstacle(ObstacleSample const& sample) {
+	assert(!_isAsleep);
+	_obstacle = sample;
+	if (_obstacle.distance < params::aircraft::OBSTACLE_AVOID_DISTANCE) {
+		_isOnOrbit = false;
+	}
+}
+
+void Aircraft::saveState(AircraftState& state) {
+	_evaluateSleep();
+	state.position = _position;
+	state.speed = _speed;
+	state.angle = _angle;
+	state.rotation = _rotation;
+	state.flightTime = _flightTime;
+	state.returnCheckTime = _returnCheckTime;
+	state.target = _target;
+	state.obstacle = _obstacle;
+	state.distanceToShip = _distanceToShip;
+	state.status = _status;
+	state.isOnOrbit = _isOnOrbit ? 1u : 0u;
+	state.orbitRadius = _isOnOrbit ? _orbitRadius : 0.f;
+	state.orbitStartPhase = _isOnOrbit ? _orbitStartPhase : 0.f;
+	state.orbitAngularSpeed = _isOnOrbit ? _orbitAngularSpeed : 0.f;
+	state.orbitTime = _isOnOrbit ? _orbitTime : 0.f;
+	state.isAsleep = _isAsleep ? 1u : 0u;
+	state.sleepClock = _isAsleep ? _sleepClock : 0.f;
+	state.sleepFlightTime = _isAsleep ? _sleepFlightTime : 0.f;
+	state.sleepOrbitTime = _isAsleep ? _sleepOrbitTime : 0.f;
+	state.wakeClock = _isAsleep ? _wakeClock : 0.f;
+}
+
+void Aircraft::restoreState(AircraftState const& state) {
+	assert(state.status >= ReadyToFlight && state.status < AircraftStatus::Count);
+	_position = state.position;
+	_speed = state.speed;
+	_angle = state.angle;
+	_rotation = state.rotation;
+	_flightTime = state.flightTime;
+	_returnCheckTime = state.returnCheckTime;
+	_target = state.target;
+	_obstacle = state.obstacle;
+	_distanceToShip = state.distanceToShip;
+	_status = (AircraftStatus)state.status;
+	_isOnOrbit = state.isOnOrbit != 0;
+	_orbitRadius = state.orbitRadius;
+	_orbitStartPhase = state.orbitStartPhase;
+	_orbitAngularSpeed = state.orbitAngularSpeed;
+	_orbitTime = state.orbitTime;
+	_isAsleep = state.isAsleep != 0;
+	_sleepClock = state.sleepClock;
+	_sleepFlightTime = state.sleepFlightTime;
+	_sleepOrbitTime = state.sleepOrbitTime;
+	_wakeClock = state.wakeClock;
+	_evaluatedClock = -1.f;
+
+	bool isFlying = _status == TakeOff || _status == LayInACourse || _status == Returning;
+	if (isFlying && !_mesh) {
+		_mesh = scene::createMesh(params::aircraft::MESH_NAME);
+		_transform = transforms::create(_mesh);
+		_collisionProxy = collision::createProxy(collision::AircraftBody, this, &_mothership);
+	}
+	else if (!isFlying && _mesh) {
+		transforms::destroy(_transform);
+		_transform = transforms::NO_TRANSFORM;
+		scene::destroyMesh(_mesh);
+		_mesh = nullptr;
+		collision::destroyProxy(_collisionProxy);
+		_collisionProxy = collision::NO_PROXY;
+	}
+	if (_mesh) {
+		transforms::setParent(_transform, _status == TakeOff ? _mothership.getTransform() : transforms::NO_TRANSFORM);
+		_evaluateSleep();
+		_placeBody();
+	}
+}
+
+void Aircraft::shiftOrigin(Vector2 offset) {
+	_position = _position - offset;
+	_target = _target - offset;
+	//Evaluated again from the moved target, so the pose doesn't depend on whether it was asked for before
+	_evaluatedClock = -1.f;
+	if (_mesh) {
+		_evaluateSleep();
+		_placeBody();
+	}
+}
+
+bool Aircraft::isOnOrbit() {
+	return _isOnOrbit;
+}
+
+bool Aircraft::isAsleep() {
+	return _isAsleep;
+}
+
+void Aircraft::sleep() {
+	assert(_status == LayInACourse && _isOnOrbit && !_isAsleep && !isReturnCheckDue());
+	_isAsleep = true;
+	_sleepClock = _mothership.getAircraftClock();
+	_sleepFlightTime = _flightTime;
+	_sleepOrbitTime = _orbitTime;
+	_wakeClock = _sleepClock + (_returnCheckTime - _flightTime);
+	//The pose snaps to the closed form right away, so it never depends on when it is evaluated
+	_evaluatedClock = -1.f;
+	_evaluateSleep();
 }
 
+void Aircraft::wake() {
+	assert(_isAsleep);
+	_evaluateSleep();
+	_isAsleep = false;
+	_placeBody();
+}
 
-float Aircraft::_timeForMakingCircle() {
-	return 2 * params::precision::PI_CONST / params::aircraft::ANGULAR_SPEED;
+float Aircraft::getWakeClock() {
+	return _wakeClock;
 }
 
-float Aircraft::_timeForReturning() {
-	return sqrt((_mothership.getPosition() - _position).lengthSquare()) / (params::aircraft::LINEAR_SPEED - params::ship::LINEAR_SPEED);
+void Aircraft::placeAsleep() {
+	_evaluateSleep();
+	_placeBody();
+}
+
+void Aircraft::shiftClock(float offset) {
+	_sleepClock -= offset;
+	_wakeClock -= offset;
+	_evaluatedClock = -1.f;
+}
+
+
+float Aircraft::_timeForAccelerating() {
+	//Flying at full speed from the start would be ahead by (LINEAR_SPEED - speed)^2 / (2 * LINEAR_ACCELERATION)
+	float speedDeficit = std::max(params::aircraft::LINEAR_SPEED - _speed, 0.f);
+	return speedDeficit * speedDeficit / (2.f * params::aircraft::LINEAR_ACCELERATION * params::aircraft::LINEAR_SPEED);
 }
 
 float Aircraft::_timeForLanding() {
@@ -170,8 +528,16 @@ float Aircraft::_timeForLanding() {
 }
 
 
-bool Aircraft::_isAircraftNearTheMothership() {
-	if ((_mothership.getPosition() - _position).lengthSquare() <= std::pow(params::ship::LANDING_RADIUS, 2)) {
+bool Aircraft::_isAircraftNearTheMothership(Vector2 startOffset) {
+	//Large steps can carry the aircraft across the landing circle, so the closest approach during the step counts
+	Vector2 offset = _position - _mothership.getPosition();
+	Vector2 motion = offset - startOffset;
+	float motionLengthSquare = motion.lengthSquare();
+	if (motionLengthSquare > params::precision::ZERO_COMPARISON) {
+		float along = -(startOffset.x * motion.x + startOffset.y * motion.y) / motionLengthSquare;
+		offset = startOffset + std::min(std::max(along, 0.f), 1.f) * motion;
+	}
+	if (offset.lengthSquare() <= params::ship::LANDING_RADIUS * params::ship::LANDING_RADIUS) {
 		return true;
 	}
 	return false;
@@ -185,9 +551,7 @@ float Aircraft::_getDeltaSpeed(float acceleration, float dt, float targetSpeed)
 	return sign(targetSpeed - _speed) * dt * acceleration;
 }
 
-bool Aircraft::_isOnCourse() {
-	bool isSuccess;
-	float relativeCourseAngle = _getRelativePatrolAngle(params::aircraft::PATROL_RADIUS, &isSuccess);
+bool Aircraft::_isOnCourse(float relativeCourseAngle, bool isSuccess) {
 	if (!isSuccess) {
 		return false;
 	}
@@ -200,7 +564,7 @@ bool Aircraft::_isOnCourse() {
 
 float Aircraft::_getRelativePatrolAngle(float patrolRadius, bool* isSuccess) {
 	Vector2 pathToTarget = _target - _position;
-	float pathLength = sqrt(pathToTarget.lengthSquare());
+	float pathLength = dmath::sqrt(pathToTarget.lengthSquare());
 	if (pathLength <= patrolRadius) {
 		if (isSuccess != NULL) {
 			*isSuccess = false;
@@ -208,8 +572,8 @@ float Aircraft::_getRelativePatrolAngle(float patrolRadius, bool* isSuccess) {
 		return false;
 	}
 	else {
-		float radiusAngle = asin(patrolRadius / pathLength);
-		float targetAngle = atan2(pathToTarget.y, pathToTarget.x);
+		float radiusAngle = dmath::asin(patrolRadius / pathLength);
+		float targetAngle = dmath::atan2(pathToTarget.y, pathToTarget.x);
 		float patrolAngle = targetAngle - radiusAngle;
 		float pi = params::precision::PI_CONST;
 		float relativePatrolAngle = _getVectorsAngleDistance(patrolAngle, _angle);
@@ -226,8 +590,8 @@ bool Aircraft::_isBrakeTime(float targetSpeed, float acceleration, Vector2 targe
 		return false;
 	}
 	float timeToBrake = (_speed - targetSpeed) / acceleration;
-	float brakingDistance = targetSpeed * timeToBrake + acceleration * pow(timeToBrake,2)* 0.5f;
-	return sqrt((targetPosition - _position).lengthSquare()) - params::aircraft::PATROL_RADIUS < brakingDistance;
+	float brakingDistance = targetSpeed * timeToBrake + acceleration * timeToBrake * timeToBrake * 0.5f;
+	return dmath::sqrt((targetPosition - _position).lengthSquare()) - params::aircraft::PATROL_RADIUS < brakingDistance;
 }
 
 float Aircraft::_getAcceleration(Vector2 target, float targetSpeed, float dt) {
@@ -248,15 +612,33 @@ float Aircraft::_getAcceleration(float targetSpeed, float dt) {
 }
 
 
-float Aircraft::_getLayInACourseDeltaAngle(float dt) {
-	bool isSuccess;
-	float relativePatrolAngle = _getRelativePatrolAngle(params::aircraft::PATROL_RADIUS, &isSuccess);
-	if (abs(relativePatrolAngle) <= params::aircraft::ANGULAR_SPEED * dt) {
-		return relativePatrolAngle;
+float Aircraft::_getTurnDeltaAngle(float relativeAngle, float dt) {
+	if (abs(relativeAngle) <= params::aircraft::ANGULAR_SPEED * dt) {
+		return relativeAngle;
 	}
 	else {
-		return sign(relativePatrolAngle) * (params::aircraft::ANGULAR_SPEED * dt);
+		return sign(relativeAngle) * (params::aircraft::ANGULAR_SPEED * dt);
+	}
+}
+
+float Aircraft::_getObstacleAvoidingAngle(float relativeCourseAngle) {
+	if (_obstacle.distance >= params::aircraft::OBSTACLE_AVOID_DISTANCE) {
+		return relativeCourseAngle;
+	}
+	Vector2 gradient = _obstacle.gradient;
+	float gradientLengthSquare = gradient.lengthSquare();
+	float courseAngle = _angle + relativeCourseAngle;
+	Vector2 course(dmath::cos(courseAngle), dmath::sin(courseAngle));
+	float intoShore = course.x * gradient.x + course.y * gradient.y;
+	if (gradientLengthSquare <= params::precision::ZERO_COMPARISON || intoShore >= 0.f) {
+		return relativeCourseAngle;
+	}
+	//Drop the part of the course that leads into the shore, keep the part along it
+	Vector2 alongShore = course - (intoShore / gradientLengthSquare) * gradient;
+	if (alongShore.lengthSquare() <= params::precision::ZERO_COMPARISON) {
+		alongShore = Vector2(-gradient.y, gradient.x);
 	}
+	return _getVectorsAngleDistance(dmath::atan2(alongShore.y, alongShore.x), _angle);
 }
 
 float Aircraft::_getVectorsAngleDistance(float first, float second) {
@@ -265,12 +647,12 @@ float Aircraft::_getVectorsAngleDistance(float first, float second) {
 	//We add PI before fmod and substract PI after fmod for making result in [-PI, PI];
 	float difference = first - second + (pi);
 	if (difference < 0) {
-		difference = fmod(difference, 2 * pi);
+		difference = dmath::fmod(difference, 2 * pi);
 		//We add 2PI for guarantee angle positivness;
 		difference += 2 * pi;
 	}
 	else {
-		difference = fmod(difference, 2 * pi);
+		difference = dmath::fmod(difference, 2 * pi);
 	}
 	difference -= pi;
 	return difference;
@@ -1,7 +1,12 @@
 #pragma once
 #include "../framework/scene.hpp"
 #include "supporting_function.h"
+#include "collision.h"
+#include "distance_field.h"
+#include "return_cost.h"
+#include "transforms.h"
 
+#include <cstdint>
 #include <memory>
 
 class Ship;
@@ -15,6 +20,33 @@ enum AircraftStatus {
 	Count
 };
 
+//Everything an aircraft needs to continue its flight, mesh and collision come back with the status.
+//Plain four byte fields in a fixed order, so equal states are equal bytes
+struct AircraftState
+{
+	Vector2 position;
+	float speed;
+	float angle;
+	Rotation2 rotation;
+	float flightTime;
+	float returnCheckTime;
+	Vector2 target;
+	ObstacleSample obstacle;
+	float distanceToShip;
+	int32_t status;
+	uint32_t isOnOrbit;
+	float orbitRadius;
+	float orbitStartPhase;
+	float orbitAngularSpeed;
+	float orbitTime;
+	uint32_t isAsleep;
+	float sleepClock;
+	float sleepFlightTime;
+	float sleepOrbitTime;
+	float wakeClock;
+};
+static_assert(std::is_trivially_copyable<AircraftState>::value, "aircraft states are saved as raw bytes");
+
 enum TurnDecision {
 	OnPatrolCircle,
 	OnCourse,
@@ -29,40 +61,134 @@ public:
 	void init();
 	void deinit();
 	bool Takeoff();
-	void update(float dt);
+	//The mothership keeps its aircraft in a list per status and calls the update of that
+	//status for each of them. Flight time advances, the next status is stored and returned.
+	//Ready aircraft have nothing to update
+	AircraftStatus updateTakeOff(float dt);
+	AircraftStatus updateLayInACourse(float dt);
+	AircraftStatus updateReturning(float dt);
+	AircraftStatus updateFuelling(float dt);
 	void setTarget(Vector2 target);
+	AircraftStatus getStatus();
+	float getFlightTime();
+	Vector2 getPosition();
+	//Center of the patrol orbit
+	Vector2 getTarget();
+	float getSpeed();
+	float getAngle();
+	uint32_t hashState(uint32_t hash);
+	//Must be called when the mothership jumps instead of sailing,
+	//otherwise the return decision may be taken late
+	void recheckReturningTime();
+	//Sleeping counterpart of recheckReturningTime, the jump may add up to time to the way back,
+	//so the check comes that much earlier and the aircraft keeps sleeping until then
+	void advanceReturnCheck(float time);
+	//The mothership checks its aircraft after updating them: the due ones add
+	//their lookup to the batch and get the interpolated time back in the same order
+	bool isReturnCheckDue();
+	void addReturnCheck(ReturnCostBatch& batch);
+	void finishReturnCheck(float returnTime);
+	void shiftOrigin(Vector2 offset);
+	//Nearest shore at the aircraft position, the course bends along it
+	void setObstacle(ObstacleSample const& sample);
+	void saveState(AircraftState& state);
+	//Only the mothership restores its aircraft, it rebuilds the status lists afterwards
+	void restoreState(AircraftState const& state);
+
+	//A steady orbit needs no update: the mothership stops updating the aircraft once it is
+	//on one, until a retarget, a jump of the mothership or the next return check wakes it.
+	//Asleep, flight time and pose are functions of the mothership aircraft clock, evaluated
+	//when they are asked for. Sleeping aircraft get no obstacle samples, an orbit is only
+	//entered with every point of it clear of shores
+	bool isOnOrbit();
+	bool isAsleep();
+	void sleep();
+	void wake();
+	//Aircraft clock at which the next return check is due
+	float getWakeClock();
+	//Mesh and collision body of a sleeping aircraft are placed only for drawing
+	void placeAsleep();
+	//The mothership took offset off its aircraft clock
+	void shiftClock(float offset);
 private:
 
+	//Each phase returns the status for the next frame
+	AircraftStatus _updateTakeOff(float dt);
+	AircraftStatus _updateLayInACourse(float dt);
+	//Steady patrol orbit flown in closed form, the pose is a function of the orbit time only
+	void _updateOrbit(float dt);
+	void _setOrbitPose();
+	//Brings flight time and pose of a sleeping aircraft to the mothership aircraft clock
+	void _evaluateSleep();
+	bool _isOrbitSteady();
+	void _enterOrbit();
+	AircraftStatus _updateReturning(float dt);
+	AircraftStatus _updateFuelling(float dt);
+
 	void changeInternalState(float acceleration, float deltaAngle, float dt);
+	//On deck the transform follows the mothership one, the aircraft sets the pose along the deck only
+	void _placeBody();
+	void _boardDeck();
+	void _leaveDeck();
 	bool _isTakeOffFinished();
 
-	bool _isReturningTime();
-	float _timeForMakingCircle();
-	float _timeForReturning();
+	//Full speed is assumed by the return table, catching up to it costs this much more
+	float _timeForAccelerating();
 	float _timeForLanding();
 
-	bool _isAircraftNearTheMothership();
+	//startOffset is the aircraft position relative to the mothership at the step start
+	bool _isAircraftNearTheMothership(Vector2 startOffset);
 	float _getDeltaSpeed(float acceleration, float dt, float targetSpeed);
-	bool _isOnCourse();
+	bool _isOnCourse(float relativeCourseAngle, bool isSuccess);
 	float _getRelativePatrolAngle(float patrolRadius, bool* status);
 	bool _isBrakeTime(float targetSpeed, float acceleration, Vector2 targetPosition);
 	float _getAcceleration(Vector2 target, float targetSpeed, float dt);
 	float _getAcceleration(float targetSpeed, float dt);
-	float _getLayInACourseDeltaAngle(float dt);
+	//Turn to relativeAngle limited by angular speed
+	float _getTurnDeltaAngle(float relativeAngle, float dt);
+	//Course relative angle slid along the shore when it leads into an island
+	float _getObstacleAvoidingAngle(float relativeCourseAngle);
 	
 	//return value is [-pi; pi]
 	float _getVectorsAngleDistance(float first, float second);
 
 	
 	scene::Mesh* _mesh;
+	collision::ProxyId _collisionProxy;
+	transforms::TransformId _transform;
 	Ship& _mothership;
 	
 	Vector2 _position;
 	float _speed;
 	float _angle;
+	//Follows _angle, turned by _turn only when the aircraft turns
+	Rotation2 _rotation;
+	//Rotation of the last turn step, steady turns reuse it
+	float _turnAngle;
+	Rotation2 _turn;
 	float _flightTime;
+	//Return condition is not evaluated until flight time reaches it
+	float _returnCheckTime;
 
 	Vector2 _target;
+	ObstacleSample _obstacle;
+
+	//Circle around _target flown on rails, until a retarget, a shore or the return decision
+	bool _isOnOrbit;
+	float _orbitRadius;
+	float _orbitStartPhase;
+	//Signed, positive is counterclockwise
+	float _orbitAngularSpeed;
+	float _orbitTime;
+
+	bool _isAsleep;
+	//Aircraft clock, flight time and orbit time when the aircraft fell asleep
+	float _sleepClock;
+	float _sleepFlightTime;
+	float _sleepOrbitTime;
+	float _wakeClock;
+	//Aircraft clock the current flight time and pose are for, negative when they are stale
+	float _evaluatedClock;
 	
 	AircraftStatus _status;
 
@@ -0,0 +1,393 @@
+#include "checkpoint.h"
+#include "checkpoint_format.h"
+#include "../framework/allocation_tracker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+namespace
+{
+	using namespace checkpoint::format;
+	using checkpoint::StreamCount;
+
+	//A base checkpoint after this many deltas, restoring reads at most that many
+	constexpr uint32_t DELTAS_PER_BASE = 15;
+	constexpr auto WRITER_IDLE_SLEEP = std::chrono::milliseconds(1);
+
+	//Raw records of every stream, vectors are grown only when a stream outgrows them
+	struct Frame
+	{
+		float time = 0.f;
+		uint32_t counts[StreamCount] = {};
+		std::vector<uint8_t> records[StreamCount];
+	};
+
+	//Filled by the simulation thread while isPendingFull is clear, owned by the writer while it is set
+	Frame pending;
+	//Last written checkpoint, writer thread only
+	Frame written;
+	std::atomic<bool> isPendingFull(false);
+	std::atomic<bool> isStopping(false);
+	std::thread writer;
+	FILE* file = nullptr;
+	uint32_t recordSizes[StreamCount];
+	bool isRecording = false;
+	uint32_t checkpointCount = 0;
+	int skippedCheckpoints = 0;
+
+
+	void appendU32(std::vector<uint8_t>& bytes, uint32_t value)
+	{
+		for (int shift = 0; shift < 32; shift += 8) {
+			bytes.push_back((uint8_t)(value >> shift));
+		}
+	}
+
+
+	uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+
+	void writeHeader()
+	{
+		std::vector<uint8_t> bytes(FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+		appendU32(bytes, VERSION);
+		appendU32(bytes, StreamCount);
+		for (uint32_t size : recordSizes) {
+			appendU32(bytes, size);
+		}
+		appendU32(bytes, CHUNK_RECORDS);
+		std::fwrite(bytes.data(), 1, bytes.size(), file);
+	}
+
+
+	bool isChunkDirty(int stream, uint32_t first, uint32_t count)
+	{
+		if (first + count > written.counts[stream]) {
+			return true;
+		}
+		size_t offset = (size_t)first * recordSizes[stream];
+		return std::memcmp(pending.records[stream].data() + offset, written.records[stream].data() + offset, (size_t)count * recordSizes[stream]) != 0;
+	}
+
+
+	//Runs on the writer thread only
+	void writeCheckpoint(uint32_t index, std::vector<uint8_t>& bytes)
+	{
+		bool isBase = index % (DELTAS_PER_BASE + 1) == 0;
+		bytes.clear();
+		appendU32(bytes, CHECKPOINT_MAGIC);
+		appendU32(bytes, index);
+		appendU32(bytes, floatBits(pending.time));
+		appendU32(bytes, isBase ? 1u : 0u);
+		//byteSize and chunkCount are patched once the chunks are known
+		size_t byteSizeOffset = bytes.size();
+		appendU32(bytes, 0u);
+		for (uint32_t count : pending.counts) {
+			appendU32(bytes, count);
+		}
+		size_t chunkCountOffset = bytes.size();
+		appendU32(bytes, 0u);
+
+		uint32_t chunkCount = 0;
+		for (int stream = 0; stream < StreamCount; stream++) {
+			for (uint32_t first = 0; first < pending.counts[stream]; first += CHUNK_RECORDS) {
+				uint32_t count = std::min(CHUNK_RECORDS, pending.counts[stream] - first);
+				if (!isBase && !isChunkDirty(stream, first, count)) {
+					continue;
+				}
+				appendU32(bytes, (uint32_t)stream);
+				appendU32(bytes, first);
+				appendU32(bytes, count);
+				uint8_t const* records = pending.records[stream].data() + (size_t)first * recordSizes[stream];
+				bytes.insert(bytes.end(), records, records + (size_t)count * recordSizes[stream]);
+				chunkCount++;
+			}
+		}
+
+		uint32_t byteSize = (uint32_t)(bytes.size() - CHECKPOINT_HEADER_SIZE);
+		for (int shift = 0; shift < 32; shift += 8) {
+			bytes[byteSizeOffset + shift / 8] = (uint8_t)(byteSize >> shift);
+			bytes[chunkCountOffset + shift / 8] = (uint8_t)(chunkCount >> shift);
+		}
+		std::fwrite(bytes.data(), 1, bytes.size(), file);
+		//A soak run that dies keeps every checkpoint written so far
+		std::fflush(file);
+	}
+
+
+	void runWriter()
+	{
+		allocations::Scope allocationScope(allocations::SUBSYSTEM_BACKGROUND);
+		std::vector<uint8_t> bytes;
+		uint32_t index = 0;
+		while (true) {
+			if (isPendingFull.load(std::memory_order_acquire)) {
+				writeCheckpoint(index++, bytes);
+				//The written checkpoint becomes the reference, the old reference is overwritten next time
+				std::swap(pending, written);
+				isPendingFull.store(false, std::memory_order_release);
+				continue;
+			}
+			if (isStopping.load(std::memory_order_acquire)) {
+				return;
+			}
+			std::this_thread::sleep_for(WRITER_IDLE_SLEEP);
+		}
+	}
+
+
+	//Reading
+
+	//Files of long runs pass 2 GB, beyond the long offsets of ftell and fseek on Windows
+	int64_t tellFile(FILE* input)
+	{
+#ifdef _MSC_VER
+		return _ftelli64(input);
+#else
+		return (int64_t)ftello(input);
+#endif
+	}
+
+
+	bool seekFile(FILE* input, int64_t offset, int origin)
+	{
+#ifdef _MSC_VER
+		return _fseeki64(input, offset, origin) == 0;
+#else
+		return fseeko(input, (off_t)offset, origin) == 0;
+#endif
+	}
+
+
+	bool readU32(FILE* input, uint32_t& value)
+	{
+		uint8_t bytes[4];
+		if (std::fread(bytes, 1, sizeof(bytes), input) != sizeof(bytes)) {
+			return false;
+		}
+		value = (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+		return true;
+	}
+
+
+	struct CheckpointHeader
+	{
+		uint32_t index;
+		float time;
+		bool isBase;
+		uint32_t byteSize;
+	};
+
+
+	bool readCheckpointHeader(FILE* input, CheckpointHeader& header)
+	{
+		uint32_t magic, timeBits, isBase;
+		if (!readU32(input, magic) || magic != CHECKPOINT_MAGIC || !readU32(input, header.index) || !readU32(input, timeBits)
+			|| !readU32(input, isBase) || !readU32(input, header.byteSize)) {
+			return false;
+		}
+		std::memcpy(&header.time, &timeBits, sizeof(header.time));
+		header.isBase = isBase != 0;
+		return true;
+	}
+
+
+	bool applyCheckpoint(FILE* input, uint32_t const sizes[StreamCount], checkpoint::Snapshot& snapshot)
+	{
+		for (int stream = 0; stream < StreamCount; stream++) {
+			if (!readU32(input, snapshot.counts[stream])) {
+				return false;
+			}
+			snapshot.records[stream].resize((size_t)snapshot.counts[stream] * sizes[stream]);
+		}
+		uint32_t chunkCount;
+		if (!readU32(input, chunkCount)) {
+			return false;
+		}
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+			uint32_t stream, first, count;
+			if (!readU32(input, stream) || !readU32(input, first) || !readU32(input, count)) {
+				return false;
+			}
+			if (stream >= StreamCount || first + count > snapshot.counts[stream]) {
+				return false;
+			}
+			size_t byteCount = (size_t)count * sizes[stream];
+			uint8_t* records = snapshot.records[stream].data() + (size_t)first * sizes[stream];
+			if (std::fread(records, 1, byteCount, input) != byteCount) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	bool loadFrom(FILE* input, uint32_t const sizes[StreamCount], uint32_t index, checkpoint::Snapshot& snapshot)
+	{
+		char magic[sizeof(FILE_MAGIC)];
+		uint32_t version, streamCount, chunkRecords;
+		if (std::fread(magic, 1, sizeof(magic), input) != sizeof(magic) || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0
+			|| !readU32(input, version) || version != VERSION || !readU32(input, streamCount) || streamCount != StreamCount) {
+			return false;
+		}
+		for (int stream = 0; stream < StreamCount; stream++) {
+			uint32_t size;
+			if (!readU32(input, size) || size != sizes[stream]) {
+				return false;
+			}
+		}
+		if (!readU32(input, chunkRecords)) {
+			return false;
+		}
+
+		//Headers only, to find the base the checkpoint starts from
+		int64_t baseOffset = -1;
+		CheckpointHeader header;
+		while (true) {
+			int64_t offset = tellFile(input);
+			if (!readCheckpointHeader(input, header)) {
+				return false;
+			}
+			if (header.isBase) {
+				baseOffset = offset;
+			}
+			if (header.index == index) {
+				break;
+			}
+			if (!seekFile(input, header.byteSize, SEEK_CUR)) {
+				return false;
+			}
+		}
+		if (baseOffset < 0 || !seekFile(input, baseOffset, SEEK_SET)) {
+			return false;
+		}
+
+		do {
+			if (!readCheckpointHeader(input, header) || !applyCheckpoint(input, sizes, snapshot)) {
+				return false;
+			}
+		} while (header.index != index);
+		snapshot.time = header.time;
+		return true;
+	}
+}
+
+
+namespace checkpoint
+{
+	bool start(char const* path, uint32_t const sizes[StreamCount], uint32_t const capacities[StreamCount])
+	{
+		assert(!file);
+		file = std::fopen(path, "wb");
+		if (!file) {
+			std::fprintf(stderr, "checkpoint: can't open %s\n", path);
+			return false;
+		}
+		for (int stream = 0; stream < StreamCount; stream++) {
+			recordSizes[stream] = sizes[stream];
+			for (Frame* frame : { &pending, &written }) {
+				frame->counts[stream] = 0;
+				frame->records[stream].resize((size_t)capacities[stream] * sizes[stream]);
+			}
+		}
+		writeHeader();
+		isRecording = false;
+		checkpointCount = 0;
+		skippedCheckpoints = 0;
+		isPendingFull.store(false);
+		isStopping.store(false);
+		writer = std::thread(runWriter);
+		return true;
+	}
+
+
+	void stop()
+	{
+		if (!file) {
+			return;
+		}
+		assert(!isRecording);
+		isStopping.store(true, std::memory_order_release);
+		writer.join();
+		std::fclose(file);
+		file = nullptr;
+		std::fprintf(stderr, "checkpoint: %u written, %d skipped while the writer was busy\n", checkpointCount, skippedCheckpoints);
+	}
+
+
+	bool isRunning()
+	{
+		return file != nullptr;
+	}
+
+
+	bool begin(float time, uint32_t const counts[StreamCount])
+	{
+		assert(file && !isRecording);
+		if (isPendingFull.load(std::memory_order_acquire)) {
+			skippedCheckpoints++;
+			return false;
+		}
+		pending.time = time;
+		for (int stream = 0; stream < StreamCount; stream++) {
+			pending.counts[stream] = counts[stream];
+			size_t size = (size_t)counts[stream] * recordSizes[stream];
+			if (pending.records[stream].size() < size) {
+				//The stream outgrew its capacity, the only case the simulation thread allocates
+				pending.records[stream].resize(size);
+			}
+		}
+		isRecording = true;
+		return true;
+	}
+
+
+	void* getRecords(Stream stream)
+	{
+		assert(isRecording);
+		return pending.records[stream].data();
+	}
+
+
+	void end()
+	{
+		assert(isRecording);
+		isRecording = false;
+		checkpointCount++;
+		isPendingFull.store(true, std::memory_order_release);
+	}
+
+
+	void const* Snapshot::getRecord(Stream stream, uint32_t index, size_t size) const
+	{
+		assert(index < counts[stream] && records[stream].size() >= (index + 1) * size);
+		return records[stream].data() + (size_t)index * size;
+	}
+
+
+	bool load(char const* path, uint32_t const sizes[StreamCount], uint32_t index, Snapshot& snapshot)
+	{
+		FILE* input = std::fopen(path, "rb");
+		if (!input) {
+			std::fprintf(stderr, "checkpoint: can't open %s\n", path);
+			return false;
+		}
+		bool isLoaded = loadFrom(input, sizes, index, snapshot);
+		std::fclose(input);
+		if (!isLoaded) {
+			std::fprintf(stderr, "checkpoint: %s has no valid checkpoint %u\n", path, index);
+		}
+		return isLoaded;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-------------------------------------------------------
+//	Incremental checkpoints of long simulations.
+//	Simulation thread only writes raw entity states into
+//	the pending checkpoint, a background thread compares it
+//	with the previous one chunk by chunk and writes the
+//	chunks that changed. While the writer is busy a new
+//	checkpoint is refused instead of stalling the simulation.
+//-------------------------------------------------------
+
+namespace checkpoint
+{
+	//Every stream is an array of fixed size records
+	enum Stream {
+		GameStream,
+		ShipStream,
+		AircraftStream,
+		StreamCount
+	};
+
+	//Capacities are records expected per stream, more only cost an allocation
+	bool start(char const* path, uint32_t const recordSizes[StreamCount], uint32_t const capacities[StreamCount]);
+	void stop();
+	bool isRunning();
+
+	//False while the writer is still busy with the previous checkpoint, try again later then.
+	//Otherwise the checkpoint holds counts[stream] records of every stream until end()
+	bool begin(float time, uint32_t const counts[StreamCount]);
+	//Room for all records of the stream, the caller fills every one of them before end()
+	void* getRecords(Stream stream);
+	void end();
+
+	struct Snapshot
+	{
+		float time;
+		uint32_t counts[StreamCount];
+		std::vector<uint8_t> records[StreamCount];
+
+		void const* getRecord(Stream stream, uint32_t index, size_t size) const;
+	};
+
+	//Composes checkpoint index of the file from the base before it and the deltas up to it.
+	//Record sizes must match the ones the file was written with
+	bool load(char const* path, uint32_t const recordSizes[StreamCount], uint32_t index, Snapshot& snapshot);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+//-------------------------------------------------------
+//	Checkpoint file layout, all values little-endian.
+//
+//	header:		char magic[8], u32 version, u32 streamCount,
+//				streamCount * { u32 recordSize }, u32 chunkRecords
+//	checkpoint:	u32 CHECKPOINT_MAGIC, u32 index, f32 time, u32 isBase,
+//				u32 byteSize of everything below,
+//				streamCount * { u32 recordCount }, u32 chunkCount,
+//				chunkCount * { u32 stream, u32 firstRecord, u32 recordCount,
+//					u8 records[recordCount * recordSize] }
+//
+//	Records are raw entity states in a stable order. A base checkpoint
+//	holds every chunk, the following ones only chunks that differ from the
+//	checkpoint before them, so a checkpoint is its base plus all deltas up
+//	to it. Record counts may change, records past the count are dropped.
+//-------------------------------------------------------
+
+namespace checkpoint
+{
+	namespace format
+	{
+		constexpr char FILE_MAGIC[8] = { 'W', 'O', 'T', 'S', 'C', 'K', 'P', '1' };
+		constexpr uint32_t VERSION = 1;
+		constexpr uint32_t CHECKPOINT_MAGIC = 0x50504b43;
+		//Dirty tracking granularity, a changed record rewrites its whole chunk
+		constexpr uint32_t CHUNK_RECORDS = 64;
+		//Fixed part up to and including byteSize
+		constexpr uint32_t CHECKPOINT_HEADER_SIZE = 20;
+	}
+}
@@ -0,0 +1,269 @@
+#include "collision.h"
+#include "deterministic_math.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+namespace
+{
+	constexpr int MAX_FOOTPRINT_VERTICES = 6;
+
+	//Convex outline in mesh space, counterclockwise
+	struct Footprint
+	{
+		int vertexCount;
+		Vector2 vertices[MAX_FOOTPRINT_VERTICES];
+		float boundRadius;
+	};
+
+	//ShipMesh::draw hull outline after its -90 degrees rotation and 0.8 scale
+	constexpr Footprint SHIP_FOOTPRINT = {
+		6,
+		{ Vector2(-0.32f, 0.08f), Vector2(-0.32f, -0.08f), Vector2(-0.08f, -0.12f), Vector2(0.32f, -0.08f), Vector2(0.32f, 0.08f), Vector2(-0.08f, 0.12f) },
+		0.33f
+	};
+
+	//AircraftMesh::draw wing triangle after its -90 degrees rotation, it covers the whole silhouette
+	constexpr Footprint AIRCRAFT_FOOTPRINT = {
+		3,
+		{ Vector2(-0.1f, 0.1f), Vector2(-0.1f, -0.1f), Vector2(0.1f, 0.f) },
+		0.142f
+	};
+
+	struct Proxy
+	{
+		collision::BodyKind kind;
+		void* owner;
+		void const* group;
+		Footprint const* footprint;
+		Transform2 transform;
+	};
+
+	//Interval bound of a proxy along x, kept sorted between frames
+	struct Endpoint
+	{
+		float value;
+		collision::ProxyId proxy;
+		bool isMin;
+	};
+
+	//Thread local, so a sweep worker only ever tests the bodies of its own run
+	thread_local std::vector<Proxy> proxies;
+	thread_local std::vector<collision::ProxyId> freeProxies;
+	thread_local std::vector<Endpoint> endpoints;
+	thread_local std::vector<collision::ProxyId> activeProxies;
+
+
+	float getEndpointValue(Endpoint const& endpoint)
+	{
+		Proxy const& proxy = proxies[endpoint.proxy];
+		return endpoint.isMin ? proxy.transform.position.x - proxy.footprint->boundRadius : proxy.transform.position.x + proxy.footprint->boundRadius;
+	}
+
+
+	//Endpoints move little between frames, so insertion sort runs in almost linear time
+	void sortEndpoints()
+	{
+		for (size_t index = 1; index < endpoints.size(); index++) {
+			Endpoint endpoint = endpoints[index];
+			size_t position = index;
+			while (position > 0 && (endpoints[position - 1].value > endpoint.value ||
+				(endpoints[position - 1].value == endpoint.value && !endpoints[position - 1].isMin && endpoint.isMin))) {
+				endpoints[position] = endpoints[position - 1];
+				position--;
+			}
+			endpoints[position] = endpoint;
+		}
+	}
+
+
+	bool isFiltered(Proxy const& first, Proxy const& second)
+	{
+		if (first.group != second.group) {
+			return false;
+		}
+		return first.kind == collision::ShipBody || second.kind == collision::ShipBody;
+	}
+
+
+	bool isOverlappingVertically(Proxy const& first, Proxy const& second)
+	{
+		float distance = std::abs(first.transform.position.y - second.transform.position.y);
+		return distance <= first.footprint->boundRadius + second.footprint->boundRadius;
+	}
+
+
+	void transformFootprint(Proxy const& proxy, Vector2* vertices)
+	{
+		for (int index = 0; index < proxy.footprint->vertexCount; index++) {
+			Vector2 const& vertex = proxy.footprint->vertices[index];
+			vertices[index] = proxy.transform.apply(vertex);
+		}
+	}
+
+
+	void project(Vector2 const* vertices, int count, Vector2 const& axis, float* min, float* max)
+	{
+		*min = FLT_MAX;
+		*max = -FLT_MAX;
+		for (int index = 0; index < count; index++) {
+			float projection = vertices[index].x * axis.x + vertices[index].y * axis.y;
+			*min = std::min(*min, projection);
+			*max = std::max(*max, projection);
+		}
+	}
+
+
+	//Looks for a separating axis among polygon edge normals, otherwise keeps the axis of the smallest overlap
+	bool isOverlappingOnEdges(Vector2 const* polygon, int count, Vector2 const* other, int otherCount, Vector2* axis, float* depth)
+	{
+		for (int index = 0; index < count; index++) {
+			Vector2 edge = polygon[(index + 1) % count] - polygon[index];
+			float length = dmath::sqrt(edge.lengthSquare());
+			Vector2 normal(edge.y / length, -edge.x / length);
+
+			float min, max, otherMin, otherMax;
+			project(polygon, count, normal, &min, &max);
+			project(other, otherCount, normal, &otherMin, &otherMax);
+			float overlap = std::min(max, otherMax) - std::max(min, otherMin);
+			if (overlap <= 0.f) {
+				return false;
+			}
+			if (overlap < *depth) {
+				*depth = overlap;
+				*axis = normal;
+			}
+		}
+		return true;
+	}
+
+
+	bool testFootprints(Proxy const& first, Proxy const& second, collision::Contact* contact)
+	{
+		Vector2 firstVertices[MAX_FOOTPRINT_VERTICES];
+		Vector2 secondVertices[MAX_FOOTPRINT_VERTICES];
+		transformFootprint(first, firstVertices);
+		transformFootprint(second, secondVertices);
+
+		int firstCount = first.footprint->vertexCount;
+		int secondCount = second.footprint->vertexCount;
+		contact->depth = FLT_MAX;
+		if (!isOverlappingOnEdges(firstVertices, firstCount, secondVertices, secondCount, &contact->normal, &contact->depth) ||
+			!isOverlappingOnEdges(secondVertices, secondCount, firstVertices, firstCount, &contact->normal, &contact->depth)) {
+			return false;
+		}
+
+		Vector2 centers = second.transform.position - first.transform.position;
+		if (contact->normal.x * centers.x + contact->normal.y * centers.y < 0.f) {
+			contact->normal = -1.f * contact->normal;
+		}
+		contact->firstKind = first.kind;
+		contact->first = first.owner;
+		contact->secondKind = second.kind;
+		contact->second = second.owner;
+		return true;
+	}
+}
+
+
+namespace collision
+{
+	void reserve(int count)
+	{
+		proxies.reserve(count);
+		freeProxies.reserve(count);
+		endpoints.reserve(2 * count);
+		activeProxies.reserve(count);
+	}
+
+
+	ProxyId createProxy(BodyKind kind, void* owner, void const* group)
+	{
+		Proxy proxy;
+		proxy.kind = kind;
+		proxy.owner = owner;
+		proxy.group = group;
+		proxy.footprint = kind == ShipBody ? &SHIP_FOOTPRINT : &AIRCRAFT_FOOTPRINT;
+
+		ProxyId id;
+		if (freeProxies.empty()) {
+			id = (ProxyId)proxies.size();
+			proxies.push_back(proxy);
+			//destroyProxy returns ids here, sized with proxies it never has to grow
+			freeProxies.reserve(proxies.capacity());
+		}
+		else {
+			id = freeProxies.back();
+			freeProxies.pop_back();
+			proxies[id] = proxy;
+		}
+
+		Endpoint min = { 0.f, id, true };
+		Endpoint max = { 0.f, id, false };
+		min.value = getEndpointValue(min);
+		max.value = getEndpointValue(max);
+		endpoints.push_back(min);
+		endpoints.push_back(max);
+		return id;
+	}
+
+
+	void destroyProxy(ProxyId proxy)
+	{
+		assert(proxy >= 0 && proxy < (ProxyId)proxies.size());
+		auto newEnd = std::remove_if(endpoints.begin(), endpoints.end(), [proxy](Endpoint const& endpoint) { return endpoint.proxy == proxy; });
+		assert(endpoints.end() - newEnd == 2);
+		endpoints.erase(newEnd, endpoints.end());
+		proxies[proxy].owner = nullptr;
+		freeProxies.push_back(proxy);
+	}
+
+
+	void moveProxy(ProxyId proxy, Transform2 const& transform)
+	{
+		assert(proxy >= 0 && proxy < (ProxyId)proxies.size() && proxies[proxy].owner);
+		proxies[proxy].transform = transform;
+	}
+
+
+	float getBoundRadius(BodyKind kind)
+	{
+		return kind == ShipBody ? SHIP_FOOTPRINT.boundRadius : AIRCRAFT_FOOTPRINT.boundRadius;
+	}
+
+
+	void detect(std::vector<Contact>& contacts)
+	{
+		contacts.clear();
+		for (Endpoint& endpoint : endpoints) {
+			endpoint.value = getEndpointValue(endpoint);
+		}
+		sortEndpoints();
+
+		//Proxies whose x interval is open at the current sweep position
+		activeProxies.clear();
+		for (Endpoint const& endpoint : endpoints) {
+			if (!endpoint.isMin) {
+				auto it = std::find(activeProxies.begin(), activeProxies.end(), endpoint.proxy);
+				assert(it != activeProxies.end());
+				*it = activeProxies.back();
+				activeProxies.pop_back();
+				continue;
+			}
+
+			Proxy const& proxy = proxies[endpoint.proxy];
+			for (ProxyId activeProxy : activeProxies) {
+				Proxy const& other = proxies[activeProxy];
+				if (isFiltered(proxy, other) || !isOverlappingVertically(proxy, other)) {
+					continue;
+				}
+				Contact contact;
+				if (testFootprints(other, proxy, &contact)) {
+					contacts.push_back(contact);
+				}
+			}
+			activeProxies.push_back(endpoint.proxy);
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "supporting_function.h"
+
+#include <vector>
+
+//-------------------------------------------------------
+//	Collision detection between ships and aircraft.
+//	Broad phase is a persistent sweep-and-prune along x,
+//	narrow phase tests mesh footprints with separating axes.
+//-------------------------------------------------------
+
+namespace collision
+{
+	enum BodyKind {
+		ShipBody,
+		AircraftBody
+	};
+
+	typedef int ProxyId;
+	constexpr ProxyId NO_PROXY = -1;
+
+	struct Contact
+	{
+		BodyKind firstKind;
+		void* first;
+		BodyKind secondKind;
+		void* second;
+		//Unit vector pointing from first body to second one
+		Vector2 normal;
+		float depth;
+	};
+
+	//Proxies and both sort lists for count bodies, so launches don't grow them mid battle
+	void reserve(int count);
+	//Bodies of the same group never collide with a ship of that group: aircraft take off from their own deck
+	ProxyId createProxy(BodyKind kind, void* owner, void const* group);
+	void destroyProxy(ProxyId proxy);
+	void moveProxy(ProxyId proxy, Transform2 const& transform);
+	//Radius of a circle around the body origin that covers any rotation of its footprint
+	float getBoundRadius(BodyKind kind);
+
+	//Replaces contacts with every overlapping pair of the current frame
+	void detect(std::vector<Contact>& contacts);
+}
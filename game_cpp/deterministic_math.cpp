@@ -0,0 +1,135 @@
+#include "deterministic_math.h"
+
+#ifdef WOTS_DETERMINISTIC
+
+// Evaluated in double: every step is a basic IEEE operation, so the result is
+// reproducible, and the extra precision keeps the float result within an ulp.
+namespace
+{
+	constexpr double PI = 3.14159265358979323846;
+	constexpr double HALF_PI = 1.57079632679489661923;
+	constexpr double QUARTER_PI = 0.78539816339744830962;
+	constexpr double TWO_OVER_PI = 0.63661977236758134308;
+	// pi/2 split in two parts, HALF_PI_HIGH has zero low bits so k * HALF_PI_HIGH is exact
+	constexpr double HALF_PI_HIGH = 1.57079632673412561417e+00;
+	constexpr double HALF_PI_LOW = 6.07710050650619224932e-11;
+	constexpr double TAN_EIGHTH_PI = 0.41421356237309504880;
+
+
+	//Reduces x to [-pi/4; pi/4], quadrant receives number of pi/2 turns modulo 4
+	double reduce(float x, int* quadrant)
+	{
+		double turns = std::floor((double)x * TWO_OVER_PI + 0.5);
+		*quadrant = (int)((long long)turns & 3);
+		return ((double)x - turns * HALF_PI_HIGH) - turns * HALF_PI_LOW;
+	}
+
+
+	//Taylor series, |x| <= pi/4
+	double sinPolynomial(double x)
+	{
+		double x2 = x * x;
+		return x + x * x2 * (-1.0 / 6.0 + x2 * (1.0 / 120.0 + x2 * (-1.0 / 5040.0 + x2 * (1.0 / 362880.0 + x2 * (-1.0 / 39916800.0)))));
+	}
+
+
+	//Taylor series, |x| <= pi/4
+	double cosPolynomial(double x)
+	{
+		double x2 = x * x;
+		return 1.0 + x2 * (-1.0 / 2.0 + x2 * (1.0 / 24.0 + x2 * (-1.0 / 720.0 + x2 * (1.0 / 40320.0 + x2 * (-1.0 / 3628800.0 + x2 * (1.0 / 479001600.0))))));
+	}
+
+
+	//Taylor series, |x| <= tan(pi/8)
+	double atanPolynomial(double x)
+	{
+		double x2 = x * x;
+		double result = 0.0;
+		for (int power = 21; power >= 3; power -= 2) {
+			result = x2 * ((power % 4 == 1 ? 1.0 : -1.0) / power + result);
+		}
+		return x + x * result;
+	}
+
+
+	//x >= 0
+	double atanPositive(double x)
+	{
+		if (x > 1.0) {
+			return HALF_PI - atanPositive(1.0 / x);
+		}
+		if (x > TAN_EIGHTH_PI) {
+			return QUARTER_PI + atanPolynomial((x - 1.0) / (x + 1.0));
+		}
+		return atanPolynomial(x);
+	}
+
+
+	double atan2Double(double y, double x)
+	{
+		if (x == 0.0) {
+			if (y == 0.0) {
+				return 0.0;
+			}
+			return y > 0.0 ? HALF_PI : -HALF_PI;
+		}
+		double angle = atanPositive(std::fabs(y) / std::fabs(x));
+		if (x < 0.0) {
+			angle = PI - angle;
+		}
+		return y < 0.0 ? -angle : angle;
+	}
+}
+
+
+namespace dmath
+{
+	float sin(float x)
+	{
+		int quadrant;
+		double reduced = reduce(x, &quadrant);
+		switch (quadrant) {
+		case 0:
+			return (float)sinPolynomial(reduced);
+		case 1:
+			return (float)cosPolynomial(reduced);
+		case 2:
+			return (float)-sinPolynomial(reduced);
+		default:
+			return (float)-cosPolynomial(reduced);
+		}
+	}
+
+
+	float cos(float x)
+	{
+		int quadrant;
+		double reduced = reduce(x, &quadrant);
+		switch (quadrant) {
+		case 0:
+			return (float)cosPolynomial(reduced);
+		case 1:
+			return (float)-sinPolynomial(reduced);
+		case 2:
+			return (float)-cosPolynomial(reduced);
+		default:
+			return (float)sinPolynomial(reduced);
+		}
+	}
+
+
+	float atan2(float y, float x)
+	{
+		return (float)atan2Double((double)y, (double)x);
+	}
+
+
+	float asin(float x)
+	{
+		double value = (double)x;
+		return (float)atan2Double(value, std::sqrt(1.0 - value * value));
+	}
+}
+
+#endif
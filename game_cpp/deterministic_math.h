@@ -0,0 +1,61 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+//-------------------------------------------------------
+//	Simulation math
+//
+//	With WOTS_DETERMINISTIC defined trigonometry is evaluated by our own
+//	polynomials built from +, -, *, / and sqrt only. IEEE 754 rounds these
+//	identically on every conforming cpu, so lockstep peers fed with the same
+//	inputs stay bit-identical. Contraction into fma must stay off: msvc and
+//	clang get it from the pragmas below, gcc needs -ffp-contract=off. gcc 12
+//	still fuses rotation loops into fmaddsub when its loop vectorizer runs on
+//	fma targets, so deterministic gcc builds also pass -fno-tree-loop-vectorize.
+//	wots_steady_state_test pins the resulting state hash in its Deterministic
+//	configuration.
+//	Without the define everything forwards to the standard library.
+//-------------------------------------------------------
+
+#ifdef WOTS_DETERMINISTIC
+#if (defined(_M_IX86_FP) && _M_IX86_FP < 2) || (defined(__i386__) && !defined(__SSE2_MATH__))
+#error "deterministic simulation requires SSE2 floating point, x87 keeps excess precision"
+#endif
+#if defined(_MSC_VER)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+#endif
+
+namespace dmath
+{
+#ifdef WOTS_DETERMINISTIC
+	float sin(float x);
+	float cos(float x);
+	float atan2(float y, float x);
+	float asin(float x);
+#else
+	inline float sin(float x) { return std::sin(x); }
+	inline float cos(float x) { return std::cos(x); }
+	inline float atan2(float y, float x) { return std::atan2(y, x); }
+	inline float asin(float x) { return std::asin(x); }
+#endif
+
+	// sqrt and fmod results are exactly specified by IEEE 754 and C, deterministic as is
+	inline float sqrt(float x) { return std::sqrt(x); }
+	inline float fmod(float x, float y) { return std::fmod(x, y); }
+
+	// FNV-1a over raw bytes, used for per-frame state hashes
+	inline uint32_t hashBytes(uint32_t hash, void const* data, size_t size)
+	{
+		unsigned char const* bytes = static_cast<unsigned char const*>(data);
+		for (size_t index = 0; index < size; index++) {
+			hash = (hash ^ bytes[index]) * 16777619u;
+		}
+		return hash;
+	}
+
+	constexpr uint32_t HASH_SEED = 2166136261u;
+}
@@ -0,0 +1,203 @@
+#include "distance_field.h"
+#include "deterministic_math.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	constexpr float QUANT_COUNT = 32767.f;
+	constexpr float QUANT_STEP = params::world::OBSTACLE_RANGE / QUANT_COUNT;
+
+
+	int16_t quantize(float distance)
+	{
+		float clamped = std::max(-params::world::OBSTACLE_RANGE, std::min(params::world::OBSTACLE_RANGE, distance));
+		return (int16_t)std::lround(clamped / QUANT_STEP);
+	}
+
+
+	//Corner values are d00 at the cell origin, d10 along x, d01 along y, d11 opposite
+	inline void interpolateCell(float d00, float d10, float d01, float d11, float fractionX, float fractionY, float inverseCellSize,
+		float& distance, float& gradientX, float& gradientY)
+	{
+		float bottom = interpolateLinear(d00, d10, fractionX);
+		float top = interpolateLinear(d01, d11, fractionX);
+		distance = interpolateLinear(bottom, top, fractionY);
+		gradientX = interpolateLinear(d10 - d00, d11 - d01, fractionY) * inverseCellSize;
+		gradientY = (top - bottom) * inverseCellSize;
+	}
+
+
+	void interpolateCells(int count, float const* WOTS_RESTRICT d00, float const* WOTS_RESTRICT d10, float const* WOTS_RESTRICT d01,
+		float const* WOTS_RESTRICT d11, float const* WOTS_RESTRICT fractionX, float const* WOTS_RESTRICT fractionY,
+		float const* WOTS_RESTRICT inverseCellSize, float* WOTS_RESTRICT distances, float* WOTS_RESTRICT gradientX, float* WOTS_RESTRICT gradientY)
+	{
+		for (int index = 0; index < count; index++) {
+			interpolateCell(d00[index], d10[index], d01[index], d11[index], fractionX[index], fractionY[index], inverseCellSize[index],
+				distances[index], gradientX[index], gradientY[index]);
+		}
+	}
+
+
+	struct CellLookup
+	{
+		float corners[4];
+		float fractionX;
+		float fractionY;
+		float inverseCellSize;
+	};
+
+
+	CellLookup getOpenWaterCell()
+	{
+		float range = params::world::OBSTACLE_RANGE;
+		return CellLookup{ { range, range, range, range }, 0.f, 0.f, 0.f };
+	}
+}
+
+
+//-------------------------------------------------------
+//	DistanceField
+//-------------------------------------------------------
+
+DistanceField::DistanceField() :
+	_resolution(0),
+	_cellSize(0.f)
+{
+}
+
+
+void DistanceField::bake(std::vector<ObstacleCircle> const& circles, float size)
+{
+	assert(size > 0.f);
+	clear();
+
+	float range = params::world::OBSTACLE_RANGE;
+	std::vector<ObstacleCircle> nearCircles;
+	for (ObstacleCircle const& circle : circles) {
+		float reach = circle.radius + range;
+		if (circle.center.x > -reach && circle.center.x < size + reach && circle.center.y > -reach && circle.center.y < size + reach) {
+			nearCircles.push_back(circle);
+		}
+	}
+	if (nearCircles.empty()) {
+		return;
+	}
+
+	_resolution = std::max(2, (int)std::ceil(size / params::world::OBSTACLE_CELL_SIZE) + 1);
+	_cellSize = size / (float)(_resolution - 1);
+	_distances.resize((size_t)_resolution * _resolution);
+	for (int y = 0; y < _resolution; y++) {
+		for (int x = 0; x < _resolution; x++) {
+			Vector2 point((float)x * _cellSize, (float)y * _cellSize);
+			float distance = range;
+			for (ObstacleCircle const& circle : nearCircles) {
+				distance = std::min(distance, dmath::sqrt((point - circle.center).lengthSquare()) - circle.radius);
+			}
+			_distances[(size_t)y * _resolution + x] = quantize(distance);
+		}
+	}
+}
+
+
+void DistanceField::clear()
+{
+	_distances.clear();
+	_distances.shrink_to_fit();
+	_resolution = 0;
+	_cellSize = 0.f;
+}
+
+
+bool DistanceField::isEmpty() const
+{
+	return _distances.empty();
+}
+
+
+namespace
+{
+	CellLookup lookUp(std::vector<int16_t> const& distances, int resolution, float cellSize, Vector2 position)
+	{
+		if (distances.empty()) {
+			return getOpenWaterCell();
+		}
+		float inverseCellSize = 1.f / cellSize;
+		float limit = (float)(resolution - 1);
+		float gridX = std::max(0.f, std::min(limit, position.x * inverseCellSize));
+		float gridY = std::max(0.f, std::min(limit, position.y * inverseCellSize));
+		int cellX = std::min((int)gridX, resolution - 2);
+		int cellY = std::min((int)gridY, resolution - 2);
+		int16_t const* row = distances.data() + (size_t)cellY * resolution + cellX;
+
+		CellLookup cell;
+		cell.corners[0] = row[0] * QUANT_STEP;
+		cell.corners[1] = row[1] * QUANT_STEP;
+		cell.corners[2] = row[resolution] * QUANT_STEP;
+		cell.corners[3] = row[resolution + 1] * QUANT_STEP;
+		cell.fractionX = gridX - (float)cellX;
+		cell.fractionY = gridY - (float)cellY;
+		cell.inverseCellSize = inverseCellSize;
+		return cell;
+	}
+}
+
+
+ObstacleSample DistanceField::sample(Vector2 position) const
+{
+	CellLookup cell = lookUp(_distances, _resolution, _cellSize, position);
+	ObstacleSample result;
+	interpolateCell(cell.corners[0], cell.corners[1], cell.corners[2], cell.corners[3], cell.fractionX, cell.fractionY, cell.inverseCellSize,
+		result.distance, result.gradient.x, result.gradient.y);
+	return result;
+}
+
+
+//-------------------------------------------------------
+//	DistanceBatch
+//-------------------------------------------------------
+
+void DistanceBatch::clear()
+{
+	_inputs.clear();
+}
+
+
+void DistanceBatch::add(DistanceField const* field, Vector2 position)
+{
+	CellLookup cell = field ? lookUp(field->_distances, field->_resolution, field->_cellSize, position) : getOpenWaterCell();
+	_inputs.add({ cell.corners[0], cell.corners[1], cell.corners[2], cell.corners[3], cell.fractionX, cell.fractionY, cell.inverseCellSize });
+}
+
+
+void DistanceBatch::reserve(int count)
+{
+	_inputs.reserve(count);
+	_outputs.reserve(count);
+}
+
+
+int DistanceBatch::size() const
+{
+	return _inputs.size();
+}
+
+
+void DistanceBatch::interpolate(ObstacleSample* samples)
+{
+	int count = size();
+	_outputs.resize(count);
+	interpolateCells(count, _inputs.get(Corner00), _inputs.get(Corner10), _inputs.get(Corner01), _inputs.get(Corner11),
+		_inputs.get(FractionX), _inputs.get(FractionY), _inputs.get(InverseCellSize),
+		_outputs.get(Distance), _outputs.get(GradientX), _outputs.get(GradientY));
+
+	float const* distances = _outputs.get(Distance);
+	float const* gradientX = _outputs.get(GradientX);
+	float const* gradientY = _outputs.get(GradientY);
+	for (int index = 0; index < count; index++) {
+		samples[index].distance = distances[index];
+		samples[index].gradient = Vector2(gradientX[index], gradientY[index]);
+	}
+}
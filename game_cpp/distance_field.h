@@ -0,0 +1,79 @@
+#pragma once
+#include "soa_batch.h"
+#include "supporting_function.h"
+
+#include <cstdint>
+#include <vector>
+
+//-------------------------------------------------------
+//	Signed distance to island shores baked on a regular
+//	grid over one square area. Distances are clamped to
+//	params::world::OBSTACLE_RANGE and quantized to 16 bits;
+//	the gradient isn't stored, it comes from the same four
+//	samples as the bilinear distance, so a single lookup
+//	answers both how far and which way is open water.
+//-------------------------------------------------------
+
+struct ObstacleSample
+{
+	//Negative inside an island, OBSTACLE_RANGE away from every shore
+	float distance;
+	//Points away from the nearest shore, zero away from every shore
+	Vector2 gradient;
+};
+
+inline ObstacleSample getOpenWaterSample()
+{
+	return ObstacleSample{ params::world::OBSTACLE_RANGE, Vector2() };
+}
+
+struct ObstacleCircle
+{
+	Vector2 center;
+	float radius;
+};
+
+class DistanceField
+{
+public:
+	DistanceField();
+
+	//Circles are relative to the lower left corner of the [0; size] square,
+	//the ones farther than OBSTACLE_RANGE from it don't matter
+	void bake(std::vector<ObstacleCircle> const& circles, float size);
+	void clear();
+	//No shore within OBSTACLE_RANGE of the square, nothing is stored
+	bool isEmpty() const;
+
+	//Position is relative to the lower left corner and is clamped to the square
+	ObstacleSample sample(Vector2 position) const;
+
+private:
+	friend class DistanceBatch;
+
+	std::vector<int16_t> _distances;
+	int _resolution;
+	float _cellSize;
+};
+
+//Samples many positions at once in two passes: a table lookup per position
+//into columns, then plain arithmetic over whole columns
+class DistanceBatch
+{
+public:
+	void clear();
+	void reserve(int count);
+	//Null field is open water, position is relative to the field corner
+	void add(DistanceField const* field, Vector2 position);
+	int size() const;
+	//Writes size() samples in the order they were added
+	void interpolate(ObstacleSample* samples);
+
+private:
+	//Corner values are named by their offset along x, then y
+	enum Input { Corner00, Corner10, Corner01, Corner11, FractionX, FractionY, InverseCellSize, InputCount };
+	enum Output { Distance, GradientX, GradientY, OutputCount };
+
+	SoaColumns<InputCount> _inputs;
+	SoaColumns<OutputCount> _outputs;
+};
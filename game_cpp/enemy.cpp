@@ -0,0 +1,103 @@
+#include "enemy.h"
+#include "deterministic_math.h"
+
+EnemyCarrier::EnemyCarrier(Ship& player) :
+	_player(player),
+	_strikeCooldown(0.f),
+	_thinkInterval(params::ai::FAR_THINK_INTERVAL)
+{
+}
+
+void EnemyCarrier::init(Vector2 startPosition, float startAngle) {
+	_ship.init(startPosition, startAngle);
+	_ship.keyPressed(game::KEY_FORWARD);
+	_waypoint = startPosition;
+	_strikeCooldown = params::ai::STRIKE_COOLDOWN;
+	_thinkInterval = params::ai::FAR_THINK_INTERVAL;
+}
+
+void EnemyCarrier::deinit() {
+	_ship.deinit();
+}
+
+void EnemyCarrier::update(float dt) {
+	_strikeCooldown -= dt;
+	_steer();
+	_ship.update(dt);
+}
+
+Ship& EnemyCarrier::getShip() {
+	return _ship;
+}
+
+void EnemyCarrier::shiftOrigin(Vector2 offset) {
+	_waypoint = _waypoint - offset;
+	_ship.shiftOrigin(offset);
+}
+
+void EnemyCarrier::think() {
+	Vector2 position = _ship.getPosition();
+	Vector2 playerPosition = _player.getPosition();
+	Vector2 toPlayer = playerPosition - position;
+	float distance = dmath::sqrt(toPlayer.lengthSquare());
+
+	if (distance > params::ai::STANDOFF_DISTANCE + params::ai::STANDOFF_TOLERANCE) {
+		_waypoint = playerPosition;
+	}
+	else if (distance < params::ai::STANDOFF_DISTANCE - params::ai::STANDOFF_TOLERANCE) {
+		_waypoint = position - toPlayer;
+	}
+	else {
+		//Circle around the player keeping the distance
+		_waypoint = position + Vector2(-toPlayer.y, toPlayer.x);
+	}
+
+	if (distance < params::ai::STRIKE_RANGE && _strikeCooldown <= 0.f && _ship.launchAircraft()) {
+		_strikeCooldown = params::ai::STRIKE_COOLDOWN;
+	}
+	_ship.setAircraftTarget(playerPosition);
+
+	bool isNear = distance < params::ai::NEAR_DISTANCE || _isThreatened();
+	_thinkInterval = isNear ? params::ai::NEAR_THINK_INTERVAL : params::ai::FAR_THINK_INTERVAL;
+}
+
+float EnemyCarrier::getThinkInterval() {
+	return _thinkInterval;
+}
+
+bool EnemyCarrier::_isThreatened() {
+	Vector2 position = _ship.getPosition();
+	for (AircraftStatus status : { TakeOff, LayInACourse }) {
+		for (int index = 0; index < _player.getAircraftCount(status); index++) {
+			Vector2 offset = _player.getAircraft(status, index).getPosition() - position;
+			if (offset.lengthSquare() < params::ai::THREAT_RADIUS * params::ai::THREAT_RADIUS) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//Cheap per-frame part: turn toward the waypoint chosen by the last think
+void EnemyCarrier::_steer() {
+	Vector2 heading = _ship.getRotation().getDirection();
+	Vector2 toWaypoint = _waypoint - _ship.getPosition();
+	float cross = heading.x * toWaypoint.y - heading.y * toWaypoint.x;
+	float dot = heading.x * toWaypoint.x + heading.y * toWaypoint.y;
+	float deadZone = params::ai::STEERING_DEAD_ZONE * dmath::sqrt(toWaypoint.lengthSquare());
+
+	bool isLeft = cross > deadZone || (dot < 0.f && cross >= 0.f);
+	bool isRight = !isLeft && (cross < -deadZone || dot < 0.f);
+	if (isLeft) {
+		_ship.keyPressed(game::KEY_LEFT);
+	}
+	else {
+		_ship.keyReleased(game::KEY_LEFT);
+	}
+	if (isRight) {
+		_ship.keyPressed(game::KEY_RIGHT);
+	}
+	else {
+		_ship.keyReleased(game::KEY_RIGHT);
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "ai_scheduler.h"
+#include "ship.h"
+
+//-------------------------------------------------------
+//	AI controlled carrier: keeps a standoff distance to the
+//	player ship and sends its aircraft to strike it.
+//	Decisions are taken in think(), called by AIScheduler,
+//	every frame the carrier only steers to its waypoint
+//	through the regular Ship controls.
+//-------------------------------------------------------
+
+class EnemyCarrier : public AIThinker
+{
+public:
+	EnemyCarrier(Ship& player);
+
+	void init(Vector2 startPosition, float startAngle);
+	void deinit();
+	void update(float dt);
+	Ship& getShip();
+	void shiftOrigin(Vector2 offset);
+
+	void think() override;
+	float getThinkInterval() override;
+
+private:
+	bool _isThreatened();
+	void _steer();
+
+	Ship _ship;
+	Ship& _player;
+
+	Vector2 _waypoint;
+	float _strikeCooldown;
+	float _thinkInterval;
+};
@@ -2,9 +2,24 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 
 #include "ship.h"
 #include "aircraft.h"
+#include "collision.h"
+#include "enemy.h"
+#include "ai_scheduler.h"
+#include "checkpoint.h"
+#include "deterministic_math.h"
+#include "return_cost.h"
+#include "telemetry.h"
+#include "transforms.h"
+#include "world.h"
+#include "world_view.h"
+#include "../framework/profiler.hpp"
 
 
 //-------------------------------------------------------
@@ -14,23 +29,509 @@
 namespace game
 {
 	Ship ship;
+	//Carriers hold references to themselves, so they must not move in memory
+	std::vector<std::unique_ptr<EnemyCarrier>> enemies;
+	AIScheduler aiScheduler;
+	std::vector<collision::Contact> contacts;
+	float time = 0.f;
+	//Carriers and the aircraft flying courses, chunks are streamed around them
+	std::vector<Vector2> streamPositions;
+	std::vector<world::Island> islands;
+	std::vector<world::SpawnPoint> spawnPoints;
+	std::vector<Vector2> obstaclePositions;
+	std::vector<ObstacleSample> obstacleSamples;
+	float checkpointTimeout = params::checkpoint::INTERVAL;
+
+	//Recorders and observers stay off unless the command line names their output
+	struct Options
+	{
+		char const* worldPath = params::world::FILE_PATH;
+		char const* telemetryPath = nullptr;
+		char const* worldViewName = nullptr;
+		char const* checkpointPath = nullptr;
+		char const* restorePath = nullptr;
+		int restoreIndex = 0;
+	};
+	Options options;
+	profiler::Counter aircraftCounters[AircraftStatus::Count] = {
+		{ "AIRCRAFT READY" }, { "AIRCRAFT TAKEOFF" }, { "AIRCRAFT ON COURSE" }, { "AIRCRAFT RETURNING" }, { "AIRCRAFT FUELLING" }
+	};
+	//Scheduler statistics of the last step, latencies in simulated time
+	profiler::Counter aiThinkCounter("AI THINKS");
+	profiler::Counter aiAverageLatencyCounter("AI LATENCY AVG US");
+	profiler::Counter aiMaximalLatencyCounter("AI LATENCY MAX US");
+	profiler::Counter aiBudgetCounter("AI BUDGET USED %");
+
+
+	void resolveContact(collision::Contact const& contact)
+	{
+		//Aircraft contacts are only reported, ships can't sail through each other
+		if (contact.firstKind == collision::ShipBody && contact.secondKind == collision::ShipBody) {
+			Vector2 offset = 0.5f * contact.depth * contact.normal;
+			static_cast<Ship*>(contact.first)->pushAway(-1.f * offset);
+			static_cast<Ship*>(contact.second)->pushAway(offset);
+		}
+	}
+
+
+	void pushOutOfIslands(Ship& carrier)
+	{
+		float clearance = collision::getBoundRadius(collision::ShipBody);
+		islands.clear();
+		world::queryIslands(carrier.getPosition(), clearance, islands);
+		for (auto const& island : islands) {
+			Vector2 fromIsland = carrier.getPosition() - island.center;
+			float distance = dmath::sqrt(fromIsland.lengthSquare());
+			float depth = island.radius + clearance - distance;
+			if (depth > 0.f && distance > params::precision::ZERO_COMPARISON) {
+				carrier.pushAway((depth / distance) * fromIsland);
+			}
+		}
+	}
+
+
+	void applySeaState()
+	{
+		ship.setSeaCurrent(world::getSeaCurrent(ship.getPosition()));
+		for (auto& enemy : enemies) {
+			enemy->getShip().setSeaCurrent(world::getSeaCurrent(enemy->getShip().getPosition()));
+		}
+	}
+
+
+	void appendObstaclePositions(Ship& carrier)
+	{
+		obstaclePositions.push_back(carrier.getPosition());
+		for (int index = 0; index < carrier.getActiveAircraftCount(LayInACourse); index++) {
+			obstaclePositions.push_back(carrier.getActiveAircraft(LayInACourse, index).getPosition());
+		}
+	}
+
+
+	//Must visit carriers and aircraft in the same order as appendObstaclePositions
+	int applyObstacleSamples(Ship& carrier, int sampleIndex)
+	{
+		carrier.setObstacle(obstacleSamples[sampleIndex++]);
+		for (int index = 0; index < carrier.getActiveAircraftCount(LayInACourse); index++) {
+			carrier.getActiveAircraft(LayInACourse, index).setObstacle(obstacleSamples[sampleIndex++]);
+		}
+		return sampleIndex;
+	}
+
+
+	//Every fleet is sampled in one batch, the open ocean has nothing to avoid
+	void senseObstacles()
+	{
+		if (!world::isOpen()) {
+			return;
+		}
+		obstaclePositions.clear();
+		appendObstaclePositions(ship);
+		for (auto& enemy : enemies) {
+			appendObstaclePositions(enemy->getShip());
+		}
+		world::sampleObstacles(obstaclePositions, obstacleSamples);
+		int sampleIndex = applyObstacleSamples(ship, 0);
+		for (auto& enemy : enemies) {
+			sampleIndex = applyObstacleSamples(enemy->getShip(), sampleIndex);
+		}
+	}
+
+
+	//Sleeping aircraft keep circling their target, possibly far from the carrier, and are
+	//evaluated on demand. Their orbit is narrower than a chunk, so streaming around the
+	//target keeps the whole orbit loaded for the moment they wake and sense shores again
+	void appendStreamPositions(Ship& carrier)
+	{
+		streamPositions.push_back(carrier.getPosition());
+		int activeCount = carrier.getActiveAircraftCount(LayInACourse);
+		for (int index = 0; index < carrier.getAircraftCount(LayInACourse); index++) {
+			Aircraft& aircraft = carrier.getAircraft(LayInACourse, index);
+			streamPositions.push_back(index < activeCount ? aircraft.getPosition() : aircraft.getTarget());
+		}
+	}
+
+
+	void gatherStreamPositions()
+	{
+		streamPositions.clear();
+		appendStreamPositions(ship);
+		for (auto& enemy : enemies) {
+			appendStreamPositions(enemy->getShip());
+		}
+	}
+
+
+	//Chunks around every carrier and aircraft are in place before the first step,
+	//later the loader only has to keep ahead of them
+	void preloadWorld()
+	{
+		gatherStreamPositions();
+		for (Vector2 position : streamPositions) {
+			world::loadAround(position);
+		}
+	}
+
+
+	//Streams chunks around all fleets and keeps the player near the origin
+	void streamWorld()
+	{
+		gatherStreamPositions();
+		world::update(streamPositions);
+
+		Vector2 offset = world::rebase(ship.getPosition());
+		if (offset.x == 0.f && offset.y == 0.f) {
+			return;
+		}
+		ship.shiftOrigin(offset);
+		for (auto& enemy : enemies) {
+			enemy->shiftOrigin(offset);
+		}
+		scene::shiftOrigin(offset.x, offset.y);
+	}
+
+
+	void publishAIStats()
+	{
+		AIScheduler::Stats stats = aiScheduler.takeStats();
+		aiThinkCounter.set(stats.thinks);
+		aiAverageLatencyCounter.set((int64_t)(stats.averageLatency * 1.e6f));
+		aiMaximalLatencyCounter.set((int64_t)(stats.maximalLatency * 1.e6f));
+		aiBudgetCounter.set((int64_t)(stats.maximalBudgetShare * 100.f));
+	}
+
+
+	void countAircraft(Ship& carrier, int64_t counts[])
+	{
+		for (int status = 0; status < AircraftStatus::Count; status++) {
+			counts[status] += carrier.getAircraftCount((AircraftStatus)status);
+		}
+	}
+
+
+	void publishAircraftCounters()
+	{
+		int64_t counts[AircraftStatus::Count] = {};
+		countAircraft(ship, counts);
+		for (auto& enemy : enemies) {
+			countAircraft(enemy->getShip(), counts);
+		}
+		for (int status = 0; status < AircraftStatus::Count; status++) {
+			aircraftCounters[status].set(counts[status]);
+		}
+	}
+
+
+	void recordTelemetry(Ship& carrier)
+	{
+		Vector2 carrierPosition = carrier.getPosition();
+		for (int index = 0; index < carrier.getAircraftCount(); index++) {
+			Aircraft& aircraft = carrier.getAircraft(index);
+			telemetry::AircraftSample sample;
+			sample.position = aircraft.getPosition();
+			sample.speed = aircraft.getSpeed();
+			sample.angle = aircraft.getAngle();
+			sample.flightTime = aircraft.getFlightTime();
+			sample.status = aircraft.getStatus();
+			sample.distanceToMothership = dmath::sqrt((sample.position - carrierPosition).lengthSquare());
+			telemetry::record(sample);
+		}
+	}
+
+
+	//Carriers first, then aircraft of all of them, in the order the game keeps them
+	void publishShip(Ship& carrier, uint32_t shipIndex)
+	{
+		world_view::format::ShipRecord record;
+		Vector2 position = carrier.getPosition();
+		record.x = position.x;
+		record.y = position.y;
+		record.angle = carrier.getAngle();
+		record.isPlayer = shipIndex == 0;
+		world_view::addShip(record);
+	}
+
+
+	void publishAircraft(Ship& carrier, uint32_t shipIndex)
+	{
+		for (int index = 0; index < carrier.getAircraftCount(); index++) {
+			Aircraft& aircraft = carrier.getAircraft(index);
+			world_view::format::AircraftRecord record;
+			Vector2 position = aircraft.getPosition();
+			record.x = position.x;
+			record.y = position.y;
+			record.angle = aircraft.getAngle();
+			record.speed = aircraft.getSpeed();
+			record.flightTime = aircraft.getFlightTime();
+			record.status = aircraft.getStatus();
+			record.shipIndex = shipIndex;
+			world_view::addAircraft(record);
+		}
+	}
+
+
+	//Game part of a checkpoint, positions of the ships and aircraft are relative to this origin
+	struct CheckpointGameState
+	{
+		int32_t originChunkX;
+		int32_t originChunkY;
+	};
+
+	uint32_t const checkpointRecordSizes[checkpoint::StreamCount] = { sizeof(CheckpointGameState), sizeof(ShipState), sizeof(AircraftState) };
+
+
+	//States are saved by the carriers themselves when their update starts, carriers
+	//first and aircraft of all of them after, player first in both.
+	//Returns whether the carriers were asked to, end the checkpoint after their updates then
+	bool beginCheckpoint(float dt)
+	{
+		checkpointTimeout -= dt;
+		if (checkpointTimeout > 0.f) {
+			return false;
+		}
+		uint32_t carrierCount = 1 + (uint32_t)enemies.size();
+		uint32_t counts[checkpoint::StreamCount] = { 1, carrierCount, carrierCount * params::ship::AIRCRAFT_SHIP_CAPACITY };
+		//Writer still busy, retried next step
+		if (!checkpoint::begin(time, counts)) {
+			return false;
+		}
+		checkpointTimeout = params::checkpoint::INTERVAL;
+		auto* gameState = static_cast<CheckpointGameState*>(checkpoint::getRecords(checkpoint::GameStream));
+		float chunkSize;
+		world::getOrigin(&gameState->originChunkX, &gameState->originChunkY, &chunkSize);
+		auto* shipStates = static_cast<ShipState*>(checkpoint::getRecords(checkpoint::ShipStream));
+		auto* aircraftStates = static_cast<AircraftState*>(checkpoint::getRecords(checkpoint::AircraftStream));
+		ship.saveStateOnUpdate(&shipStates[0], &aircraftStates[0]);
+		for (uint32_t carrier = 1; carrier < carrierCount; carrier++) {
+			enemies[carrier - 1]->getShip().saveStateOnUpdate(&shipStates[carrier], &aircraftStates[carrier * params::ship::AIRCRAFT_SHIP_CAPACITY]);
+		}
+		return true;
+	}
+
+
+	//Enemy AI decisions are not part of a checkpoint, they are taken anew on the next thinks
+	bool restoreCheckpoint(char const* path, uint32_t index)
+	{
+		checkpoint::Snapshot snapshot;
+		if (!checkpoint::load(path, checkpointRecordSizes, index, snapshot)) {
+			return false;
+		}
+		uint32_t carrierCount = 1 + (uint32_t)enemies.size();
+		uint32_t aircraftCount = carrierCount * params::ship::AIRCRAFT_SHIP_CAPACITY;
+		if (snapshot.counts[checkpoint::GameStream] != 1 || snapshot.counts[checkpoint::ShipStream] != carrierCount
+			|| snapshot.counts[checkpoint::AircraftStream] != aircraftCount) {
+			std::fprintf(stderr, "checkpoint: %s was taken with a different fleet\n", path);
+			return false;
+		}
+
+		auto const& gameState = *static_cast<CheckpointGameState const*>(snapshot.getRecord(checkpoint::GameStream, 0, sizeof(CheckpointGameState)));
+		world::setOrigin(gameState.originChunkX, gameState.originChunkY);
+		for (uint32_t carrier = 0; carrier < carrierCount; carrier++) {
+			Ship& restored = carrier == 0 ? ship : enemies[carrier - 1]->getShip();
+			auto const& shipState = *static_cast<ShipState const*>(snapshot.getRecord(checkpoint::ShipStream, carrier, sizeof(ShipState)));
+			auto const* aircraftStates = static_cast<AircraftState const*>(
+				snapshot.getRecord(checkpoint::AircraftStream, carrier * params::ship::AIRCRAFT_SHIP_CAPACITY, sizeof(AircraftState)));
+			restored.restoreState(shipState, aircraftStates);
+		}
+		time = snapshot.time;
+		preloadWorld();
+		streamWorld();
+		return true;
+	}
+
+
+	void publishWorldView()
+	{
+		int32_t originChunkX, originChunkY;
+		float chunkSize;
+		world::getOrigin(&originChunkX, &originChunkY, &chunkSize);
+		world_view::beginFrame(time, originChunkX, originChunkY, chunkSize);
+		publishShip(ship, 0);
+		for (size_t index = 0; index < enemies.size(); index++) {
+			publishShip(enemies[index]->getShip(), (uint32_t)index + 1);
+		}
+		publishAircraft(ship, 0);
+		for (size_t index = 0; index < enemies.size(); index++) {
+			publishAircraft(enemies[index]->getShip(), (uint32_t)index + 1);
+		}
+		world_view::endFrame();
+	}
+
+
+	void printUsage()
+	{
+		std::printf(
+			"usage: wots [options]\n"
+			"  --world FILE           world to sail in (default world.wsw)\n"
+			"  --telemetry FILE       record aircraft telemetry\n"
+			"  --world-view NAME      publish fleet state to shared memory for observers\n"
+			"  --checkpoint FILE      write incremental checkpoints\n"
+			"  --restore FILE         start from a checkpoint\n"
+			"  --restore-index N      checkpoint to start from (default 0)\n");
+	}
+
+
+	bool parseArguments(int argc, char** argv)
+	{
+		for (int index = 1; index < argc; index++) {
+			char const* option = argv[index];
+			if (index + 1 >= argc) {
+				printUsage();
+				return false;
+			}
+			char const* value = argv[++index];
+			if (std::strcmp(option, "--world") == 0) {
+				options.worldPath = value;
+			}
+			else if (std::strcmp(option, "--telemetry") == 0) {
+				options.telemetryPath = value;
+			}
+			else if (std::strcmp(option, "--world-view") == 0) {
+				options.worldViewName = value;
+			}
+			else if (std::strcmp(option, "--checkpoint") == 0) {
+				options.checkpointPath = value;
+			}
+			else if (std::strcmp(option, "--restore") == 0) {
+				options.restorePath = value;
+			}
+			else if (std::strcmp(option, "--restore-index") == 0) {
+				options.restoreIndex = std::atoi(value);
+			}
+			else {
+				printUsage();
+				return false;
+			}
+		}
+		if (options.restoreIndex < 0) {
+			printUsage();
+			return false;
+		}
+		return true;
+	}
 
 
 	void init()
 	{
+		time = 0.f;
+		prepareReturnCostTable();
+		if (options.telemetryPath) {
+			telemetry::start(options.telemetryPath);
+		}
+		if (options.worldViewName) {
+			uint32_t carrierCapacity = 1 + params::ai::ENEMY_SHIP_COUNT;
+			world_view::start(options.worldViewName, carrierCapacity, carrierCapacity * params::ship::AIRCRAFT_SHIP_CAPACITY);
+		}
+		world::open(options.worldPath);
+		world::loadAround(Vector2());
+		spawnPoints.clear();
+		world::querySpawnPoints(Vector2(), params::world::SPAWN_SEARCH_RADIUS, spawnPoints);
+
+		//Slots for every carrier and aircraft that may exist at once,
+		//so launches and landings don't allocate in the middle of a battle
+		int carrierCount = 1 + params::ai::ENEMY_SHIP_COUNT;
+		int bodyCount = carrierCount * (1 + params::ship::AIRCRAFT_SHIP_CAPACITY);
+		transforms::reserve(bodyCount);
+		collision::reserve(bodyCount);
+		scene::reserveMeshes(bodyCount);
+		contacts.reserve(bodyCount);
+		streamPositions.reserve(bodyCount);
+		islands.reserve(params::world::MAXIMAL_NEARBY_ISLANDS);
+		obstaclePositions.reserve(bodyCount);
+		obstacleSamples.reserve(bodyCount);
+
 		ship.init();
+		for (int index = 0; index < params::ai::ENEMY_SHIP_COUNT; index++) {
+			float spawnAngle = 2.f * params::precision::PI_CONST * (index + 0.5f) / params::ai::ENEMY_SHIP_COUNT;
+			Vector2 spawnPosition(params::ai::SPAWN_RADIUS_X * dmath::cos(spawnAngle), params::ai::SPAWN_RADIUS_Y * dmath::sin(spawnAngle));
+			float startAngle = spawnAngle + params::precision::PI_CONST;
+			//World spawn points take precedence over the default ring
+			if (index < (int)spawnPoints.size()) {
+				spawnPosition = spawnPoints[index].position;
+				startAngle = spawnPoints[index].angle;
+			}
+			enemies.emplace_back(new EnemyCarrier(ship));
+			enemies.back()->init(spawnPosition, startAngle);
+			aiScheduler.add(enemies.back().get());
+		}
+
+		//A restored fleet preloads the world where it was saved
+		if (!options.restorePath || !restoreCheckpoint(options.restorePath, (uint32_t)options.restoreIndex)) {
+			preloadWorld();
+		}
+		checkpointTimeout = params::checkpoint::INTERVAL;
+		if (options.checkpointPath) {
+			uint32_t capacities[checkpoint::StreamCount] = { 1, (uint32_t)carrierCount, (uint32_t)(carrierCount * params::ship::AIRCRAFT_SHIP_CAPACITY) };
+			checkpoint::start(options.checkpointPath, checkpointRecordSizes, capacities);
+		}
 	}
 
 
 	void deinit()
 	{
+		aiScheduler.clear();
+		for (auto& enemy : enemies) {
+			enemy->deinit();
+		}
+		enemies.clear();
 		ship.deinit();
+		telemetry::stop();
+		checkpoint::stop();
+		world_view::stop();
+		world::close();
 	}
 
 
 	void update(float dt)
 	{
+		applySeaState();
+		senseObstacles();
+		//Carriers save the state this step starts from, sea and obstacle samples are taken
+		//from it again after a restore, with the same result
+		bool isCheckpointing = checkpoint::isRunning() && beginCheckpoint(dt);
 		ship.update(dt);
+		aiScheduler.update(dt);
+		for (auto& enemy : enemies) {
+			enemy->update(dt);
+		}
+		if (isCheckpointing) {
+			checkpoint::end();
+		}
+		publishAIStats();
+
+		time += dt;
+		if (telemetry::isRunning()) {
+			telemetry::beginFrame(time);
+			recordTelemetry(ship);
+			for (auto& enemy : enemies) {
+				recordTelemetry(enemy->getShip());
+			}
+			telemetry::endFrame();
+		}
+		collision::detect(contacts);
+		for (auto const& contact : contacts) {
+			resolveContact(contact);
+		}
+		pushOutOfIslands(ship);
+		for (auto& enemy : enemies) {
+			pushOutOfIslands(enemy->getShip());
+		}
+		streamWorld();
+		if (world_view::isRunning()) {
+			publishWorldView();
+		}
+		publishAircraftCounters();
+		transforms::endFrame();
+	}
+
+
+	void prepareDraw()
+	{
+		ship.placeSleepingAircraft();
+		for (auto& enemy : enemies) {
+			enemy->getShip().placeSleepingAircraft();
+		}
+		transforms::endFrame();
 	}
 
 
@@ -52,5 +553,16 @@ namespace game
 		scene::screenToWorld(&worldPosition.x, &worldPosition.y);
 		ship.mouseClicked(worldPosition, isLeftButton);
 	}
+
+
+	unsigned int getStateHash()
+	{
+		uint32_t hash = ship.hashState();
+		for (auto& enemy : enemies) {
+			uint32_t enemyHash = enemy->getShip().hashState();
+			hash = dmath::hashBytes(hash, &enemyHash, sizeof(enemyHash));
+		}
+		return hash;
+	}
 }
 
@@ -1,7 +1,11 @@
 #include "../framework/engine.hpp"
+#include "../framework/game.hpp"
 
-int main()
+int main(int argc, char** argv)
 {
+	if (!game::parseArguments(argc, argv)) {
+		return 1;
+	}
 	engine::run();
 	return 0;
 }
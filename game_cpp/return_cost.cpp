@@ -0,0 +1,318 @@
+#include "return_cost.h"
+#include "deterministic_math.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	constexpr float PI = params::precision::PI_CONST;
+
+	constexpr int DISTANCE_COUNT = 33;
+	constexpr float DISTANCE_STEP = 0.25f;
+	constexpr float MAXIMAL_TABLE_DISTANCE = (DISTANCE_COUNT - 1) * DISTANCE_STEP;
+	//Bearing is mirrored into [0; pi] together with the axis angle
+	constexpr int BEARING_COUNT = 17;
+	constexpr float BEARING_STEP = PI / (BEARING_COUNT - 1);
+	//The ship sails both ways, so only the axis matters, in [-pi/2; pi/2]
+	constexpr int AXIS_COUNT = 17;
+	constexpr float AXIS_STEP = PI / (AXIS_COUNT - 1);
+	constexpr int TABLE_SIZE = DISTANCE_COUNT * BEARING_COUNT * AXIS_COUNT;
+
+	constexpr float SIMULATION_DT = 1.f / 30.f;
+
+
+	//Everything a table is simulated with, read from the parameters of the calling thread
+	struct ReturnCostParams
+	{
+		float aircraftSpeed;
+		float aircraftAngularSpeed;
+		float shipSpeed;
+		float shipAngularSpeed;
+		float seaCurrent;
+		float landingRadius;
+		//Returns that don't reach the mothership in this time are never worth starting
+		float maximalReturnTime;
+
+		static ReturnCostParams getLive();
+		bool operator==(ReturnCostParams const& other) const;
+		//The mothership flees at full speed with the strongest current behind it
+		float getClosingSpeed() const { return aircraftSpeed - shipSpeed - seaCurrent; }
+	};
+
+
+	ReturnCostParams ReturnCostParams::getLive()
+	{
+		ReturnCostParams live;
+		live.aircraftSpeed = params::aircraft::LINEAR_SPEED;
+		live.aircraftAngularSpeed = params::aircraft::ANGULAR_SPEED;
+		live.shipSpeed = params::ship::LINEAR_SPEED;
+		live.shipAngularSpeed = params::ship::ANGULAR_SPEED;
+		live.seaCurrent = params::world::MAXIMAL_SEA_CURRENT;
+		live.landingRadius = params::ship::LANDING_RADIUS;
+		live.maximalReturnTime = params::aircraft::MAXIMAL_FLIGHT_TIME;
+		return live;
+	}
+
+
+	bool ReturnCostParams::operator==(ReturnCostParams const& other) const
+	{
+		return aircraftSpeed == other.aircraftSpeed && aircraftAngularSpeed == other.aircraftAngularSpeed
+			&& shipSpeed == other.shipSpeed && shipAngularSpeed == other.shipAngularSpeed && seaCurrent == other.seaCurrent
+			&& landingRadius == other.landingRadius && maximalReturnTime == other.maximalReturnTime;
+	}
+
+
+	int getTableIndex(int distance, int bearing, int axis)
+	{
+		return (distance * BEARING_COUNT + bearing) * AXIS_COUNT + axis;
+	}
+
+
+	//Result is in [-pi; pi]
+	float wrapAngle(float angle)
+	{
+		while (angle > PI) {
+			angle -= 2 * PI;
+		}
+		while (angle < -PI) {
+			angle += 2 * PI;
+		}
+		return angle;
+	}
+
+
+	//Result is in [-pi/2; pi/2], an axis and its opposite are the same
+	float wrapAxisAngle(float angle)
+	{
+		angle = wrapAngle(angle);
+		if (angle > 0.5f * PI) {
+			return angle - PI;
+		}
+		if (angle < -0.5f * PI) {
+			return angle + PI;
+		}
+		return angle;
+	}
+
+
+	float clampTurn(float angle, float maximalTurn)
+	{
+		return std::min(std::max(angle, -maximalTurn), maximalTurn);
+	}
+
+
+	//Aircraft starts at the origin with the mothership on the +x axis
+	float simulateReturn(ReturnCostParams const& setup, float distance, float bearing, float axisAngle)
+	{
+		Vector2 aircraftPosition;
+		float aircraftAngle = -bearing;
+		Vector2 shipPosition(distance, 0.f);
+		float shipAngle = -axisAngle;
+		float landingRadiusSquare = setup.landingRadius * setup.landingRadius;
+
+		for (float time = 0.f; time < setup.maximalReturnTime; time += SIMULATION_DT) {
+			Vector2 lineOfSight = shipPosition - aircraftPosition;
+			float lengthSquare = lineOfSight.lengthSquare();
+			if (lengthSquare <= landingRadiusSquare) {
+				return time;
+			}
+			float lineAngle = dmath::atan2(lineOfSight.y, lineOfSight.x);
+
+			//Same pursuit as Aircraft::_updateReturning, without the braking it accounts for separately
+			float aircraftTurn = clampTurn(wrapAngle(lineAngle - aircraftAngle), setup.aircraftAngularSpeed * SIMULATION_DT);
+			Vector2 aircraftMotion = getArcDisplacement(setup.aircraftSpeed, 0.f, aircraftTurn, SIMULATION_DT);
+			aircraftPosition = aircraftPosition + rotationFromAngle(aircraftAngle).rotate(aircraftMotion);
+			aircraftAngle = wrapAngle(aircraftAngle + aircraftTurn);
+
+			Rotation2 shipRotation = rotationFromAngle(shipAngle);
+			Vector2 shipDirection = shipRotation.getDirection();
+			float awaySpeed = shipDirection.x * lineOfSight.x + shipDirection.y * lineOfSight.y >= 0.f ? setup.shipSpeed : -setup.shipSpeed;
+			float shipTurn = clampTurn(wrapAxisAngle(lineAngle - shipAngle), setup.shipAngularSpeed * SIMULATION_DT);
+			Vector2 shipMotion = getArcDisplacement(awaySpeed, 0.f, shipTurn, SIMULATION_DT);
+			Vector2 current = (setup.seaCurrent * SIMULATION_DT / dmath::sqrt(lengthSquare)) * lineOfSight;
+			shipPosition = shipPosition + shipRotation.rotate(shipMotion) + current;
+			shipAngle = wrapAngle(shipAngle + shipTurn);
+		}
+		return setup.maximalReturnTime;
+	}
+
+
+	struct ReturnCostTable
+	{
+		ReturnCostParams setup;
+		float closingSpeed;
+		float times[TABLE_SIZE];
+		//Bound is boundBase + getReturnTimeBoundSlope() * distance
+		float boundBase;
+
+		explicit ReturnCostTable(ReturnCostParams const& setup);
+	};
+
+
+	ReturnCostTable::ReturnCostTable(ReturnCostParams const& setup) :
+		setup(setup),
+		closingSpeed(setup.getClosingSpeed())
+	{
+		assert(closingSpeed > 0.f && "aircraft must outrun the mothership to return");
+		std::vector<float> simulatedTimes(TABLE_SIZE);
+		for (int distance = 0; distance < DISTANCE_COUNT; distance++) {
+			for (int bearing = 0; bearing < BEARING_COUNT; bearing++) {
+				for (int axis = 0; axis < AXIS_COUNT; axis++) {
+					simulatedTimes[getTableIndex(distance, bearing, axis)] =
+						simulateReturn(setup, distance * DISTANCE_STEP, bearing * BEARING_STEP, axis * AXIS_STEP - 0.5f * PI);
+				}
+			}
+		}
+
+		//Every node takes the maximum of its neighbourhood, so each corner of a cell
+		//is at least the largest simulated time of the cell
+		float slope = 1.f / closingSpeed;
+		boundBase = 0.f;
+		for (int distance = 0; distance < DISTANCE_COUNT; distance++) {
+			for (int bearing = 0; bearing < BEARING_COUNT; bearing++) {
+				for (int axis = 0; axis < AXIS_COUNT; axis++) {
+					float time = 0.f;
+					for (int nearDistance = std::max(distance - 1, 0); nearDistance <= std::min(distance + 1, DISTANCE_COUNT - 1); nearDistance++) {
+						for (int nearBearing = std::max(bearing - 1, 0); nearBearing <= std::min(bearing + 1, BEARING_COUNT - 1); nearBearing++) {
+							for (int nearAxis = std::max(axis - 1, 0); nearAxis <= std::min(axis + 1, AXIS_COUNT - 1); nearAxis++) {
+								time = std::max(time, simulatedTimes[getTableIndex(nearDistance, nearBearing, nearAxis)]);
+							}
+						}
+					}
+					times[getTableIndex(distance, bearing, axis)] = time;
+					//Interpolated times in the cell below reach this value one step closer
+					float nearestDistance = std::max(distance - 1, 0) * DISTANCE_STEP;
+					boundBase = std::max(boundBase, time - slope * nearestDistance);
+				}
+			}
+		}
+	}
+
+
+	//Tables of every parameter set seen so far, never freed while threads may look them up
+	std::mutex tablesMutex;
+	std::vector<std::unique_ptr<ReturnCostTable const>> tables;
+	thread_local ReturnCostTable const* currentTable = nullptr;
+
+
+	ReturnCostTable const& getTable()
+	{
+		assert(currentTable && "prepareReturnCostTable must be called before return checks");
+		return *currentTable;
+	}
+
+
+	void interpolateTimes(int count, float const* WOTS_RESTRICT t000, float const* WOTS_RESTRICT t100, float const* WOTS_RESTRICT t010,
+		float const* WOTS_RESTRICT t110, float const* WOTS_RESTRICT t001, float const* WOTS_RESTRICT t101, float const* WOTS_RESTRICT t011,
+		float const* WOTS_RESTRICT t111, float const* WOTS_RESTRICT fractionDistance, float const* WOTS_RESTRICT fractionBearing,
+		float const* WOTS_RESTRICT fractionAxis, float const* WOTS_RESTRICT extraTimes, float* WOTS_RESTRICT times)
+	{
+		for (int index = 0; index < count; index++) {
+			float fraction = fractionDistance[index];
+			float t00 = interpolateLinear(t000[index], t100[index], fraction);
+			float t10 = interpolateLinear(t010[index], t110[index], fraction);
+			float t01 = interpolateLinear(t001[index], t101[index], fraction);
+			float t11 = interpolateLinear(t011[index], t111[index], fraction);
+			float t0 = interpolateLinear(t00, t10, fractionBearing[index]);
+			float t1 = interpolateLinear(t01, t11, fractionBearing[index]);
+			times[index] = interpolateLinear(t0, t1, fractionAxis[index]) + extraTimes[index];
+		}
+	}
+}
+
+
+void prepareReturnCostTable()
+{
+	ReturnCostParams live = ReturnCostParams::getLive();
+	if (currentTable && currentTable->setup == live) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(tablesMutex);
+	for (auto const& table : tables) {
+		if (table->setup == live) {
+			currentTable = table.get();
+			return;
+		}
+	}
+	tables.emplace_back(new ReturnCostTable(live));
+	currentTable = tables.back().get();
+}
+
+
+//-------------------------------------------------------
+//	ReturnCostBatch
+//-------------------------------------------------------
+
+void ReturnCostBatch::clear()
+{
+	_inputs.clear();
+}
+
+
+void ReturnCostBatch::reserve(int count)
+{
+	_inputs.reserve(count);
+}
+
+
+void ReturnCostBatch::add(float distance, float bearing, float axisAngle)
+{
+	assert(distance >= 0.f);
+	axisAngle = wrapAxisAngle(axisAngle);
+	//Mirroring the whole picture flips both angles and keeps the time
+	if (bearing < 0.f) {
+		bearing = -bearing;
+		axisAngle = -axisAngle;
+	}
+
+	float distancePosition = std::min(distance, MAXIMAL_TABLE_DISTANCE) / DISTANCE_STEP;
+	float bearingPosition = std::min(bearing, PI) / BEARING_STEP;
+	float axisPosition = std::min(std::max(axisAngle + 0.5f * PI, 0.f), PI) / AXIS_STEP;
+	int distanceCell = std::min((int)distancePosition, DISTANCE_COUNT - 2);
+	int bearingCell = std::min((int)bearingPosition, BEARING_COUNT - 2);
+	int axisCell = std::min((int)axisPosition, AXIS_COUNT - 2);
+
+	ReturnCostTable const& table = getTable();
+	float row[InputCount];
+	for (int index = Time000; index <= Time111; index++) {
+		row[index] = table.times[getTableIndex(distanceCell + (index & 1), bearingCell + ((index >> 1) & 1), axisCell + (index >> 2))];
+	}
+	row[FractionDistance] = distancePosition - distanceCell;
+	row[FractionBearing] = bearingPosition - bearingCell;
+	row[FractionAxis] = axisPosition - axisCell;
+	row[ExtraTime] = std::max(distance - MAXIMAL_TABLE_DISTANCE, 0.f) / table.closingSpeed;
+	_inputs.add(row);
+}
+
+
+int ReturnCostBatch::size() const
+{
+	return _inputs.size();
+}
+
+
+void ReturnCostBatch::interpolate(float* times)
+{
+	interpolateTimes(size(), _inputs.get(Time000), _inputs.get(Time100), _inputs.get(Time010), _inputs.get(Time110),
+		_inputs.get(Time001), _inputs.get(Time101), _inputs.get(Time011), _inputs.get(Time111),
+		_inputs.get(FractionDistance), _inputs.get(FractionBearing), _inputs.get(FractionAxis), _inputs.get(ExtraTime), times);
+}
+
+
+//-------------------------------------------------------
+//	Bound
+//-------------------------------------------------------
+
+float getReturnTimeBound(float distance)
+{
+	return getTable().boundBase + getReturnTimeBoundSlope() * distance;
+}
+
+
+float getReturnTimeBoundSlope()
+{
+	return 1.f / getTable().closingSpeed;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "soa_batch.h"
+#include "supporting_function.h"
+
+#include <vector>
+
+//-------------------------------------------------------
+//	Minimal return time of an aircraft to its mothership,
+//	precomputed once per parameter set on a grid of distance,
+//	bearing and ship axis angle. Every entry is a return
+//	flown with the real pursuit law at full speed against
+//	a mothership fleeing at full speed, turning its axis
+//	along the line of sight and pushed away by the
+//	strongest sea current. Grid values are dilated to the
+//	maximum of their neighbours, so interpolating them
+//	never falls under the simulated times of the cell.
+//-------------------------------------------------------
+
+//Selects the table for the parameters the calling thread simulates with, building it when
+//no thread did yet. Every simulation thread calls it once its parameters are set and before
+//the first lookup, tables of all threads with the same parameters are shared
+void prepareReturnCostTable();
+
+//Interpolates many lookups at once in two passes: a table fetch per lookup
+//into columns, then plain arithmetic over whole columns
+class ReturnCostBatch
+{
+public:
+	void clear();
+	void reserve(int count);
+	//Distance from the aircraft to the mothership, bearing of the mothership from the aircraft
+	//heading and the angle from the mothership heading to that line of sight, angles in [-pi; pi]
+	void add(float distance, float bearing, float axisAngle);
+	int size() const;
+	//Writes size() return times in seconds, to the landing circle, in the order they were added
+	void interpolate(float* times);
+
+private:
+	//Corner times are named by their offset along distance, bearing, then axis angle.
+	//Extra time is flown straight at the closing speed beyond the table distance
+	enum Input {
+		Time000, Time100, Time010, Time110, Time001, Time101, Time011, Time111,
+		FractionDistance, FractionBearing, FractionAxis, ExtraTime, InputCount
+	};
+
+	SoaColumns<InputCount> _inputs;
+};
+
+//Upper bound of every return time at the distance, it grows by
+//getReturnTimeBoundSlope() per distance unit
+float getReturnTimeBound(float distance);
+float getReturnTimeBoundSlope();
@@ -1,44 +1,97 @@
 
 #include "ship.h"
+#include "deterministic_math.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <limits>
+
+namespace
+{
+	//A power of two past any flight time, taking it off the aircraft clocks is exact
+	constexpr float AIRCRAFT_CLOCK_REBASE = 1024.f;
+	constexpr float NO_WAKE = std::numeric_limits<float>::max();
+}
 
 Ship::Ship() :
-	mesh(nullptr)
+	mesh(nullptr),
+	collisionProxy(collision::NO_PROXY),
+	transform(transforms::NO_TRANSFORM),
+	obstacle(getOpenWaterSample()),
+	turnAngle(0.f),
+	aircraftClock(0.f),
+	nextWakeClock(NO_WAKE),
+	pendingLaunches(0),
+	launchTimeout(0.f),
+	savedState(nullptr),
+	savedAircraftStates(nullptr)
 {
+	aircraftStorage.reserve(params::ship::AIRCRAFT_SHIP_CAPACITY);
 	for (int index = 0; index < params::ship::AIRCRAFT_SHIP_CAPACITY; index++) {
 		aircraftStorage.push_back(Aircraft(*this));
 		aircraftStorage[index].init();
 	}
+	for (auto& list : aircraftByStatus) {
+		list.reserve(params::ship::AIRCRAFT_SHIP_CAPACITY);
+	}
+	sleepingAircraft.reserve(params::ship::AIRCRAFT_SHIP_CAPACITY);
+	aircraftListPositions.resize(params::ship::AIRCRAFT_SHIP_CAPACITY);
+	statusTransitions.reserve(params::ship::AIRCRAFT_SHIP_CAPACITY);
+	resetAircraftLists();
+	returnCosts.reserve(params::ship::AIRCRAFT_SHIP_CAPACITY);
+	returnCheckAircraft.reserve(params::ship::AIRCRAFT_SHIP_CAPACITY);
+	returnTimes.reserve(params::ship::AIRCRAFT_SHIP_CAPACITY);
 }
 
-void Ship::init()
+void Ship::init(Vector2 startPosition, float startAngle)
 {
 	assert(!mesh);
-	mesh = scene::createShipMesh();
-	position = Vector2(0.f, 0.f);
-	angle = 0.f;
+	mesh = scene::createMesh(params::ship::MESH_NAME);
+	position = startPosition;
+	stepStartPosition = startPosition;
+	angle = startAngle;
+	rotation = rotationFromAngle(angle);
+	seaCurrent = Vector2();
+	obstacle = getOpenWaterSample();
+	transform = transforms::create(mesh);
+	transforms::set(transform, position, angle);
+	collisionProxy = collision::createProxy(collision::ShipBody, this, this);
+	collision::moveProxy(collisionProxy, Transform2(position, rotation));
 	for (bool& key : input) {
 		key = false;
 	}
 	for (auto& aircraft : aircraftStorage) {
 		aircraft.init();
 	}
+	aircraftClock = 0.f;
+	resetAircraftLists();
+	pendingLaunches = 0;
+	launchTimeout = 0.f;
 }
 
 
 void Ship::deinit()
 {
+	transforms::destroy(transform);
+	transform = transforms::NO_TRANSFORM;
 	scene::destroyMesh(mesh);
 	mesh = nullptr;
+	collision::destroyProxy(collisionProxy);
+	collisionProxy = collision::NO_PROXY;
 	for (auto& aircraft : aircraftStorage) {
 		aircraft.deinit();
 	}
+	resetAircraftLists();
 }
 
 
 void Ship::update(float dt)
 {
+	if (savedState) {
+		saveState();
+	}
+	updateSalvo(dt);
+
 	float linearSpeed = 0.f;
 	float angularSpeed = 0.f;
 
@@ -60,18 +113,234 @@ void Ship::update(float dt)
 		angularSpeed = -params::ship::ANGULAR_SPEED;
 	}
 
-	angle = angle + angularSpeed * dt;
-	position = position + linearSpeed * dt * Vector2(std::cos(angle), std::sin(angle));
-	scene::placeMesh(mesh, position.x, position.y, angle);
-	for (auto& aircraft : aircraftStorage) {
-		aircraft.update(dt);
+	if (obstacle.distance < params::ship::OBSTACLE_AVOID_DISTANCE && linearSpeed != 0.f) {
+		angularSpeed = getAvoidanceAngularSpeed(linearSpeed, angularSpeed);
+	}
+
+	stepStartPosition = position;
+	position = position + rotation.rotate(getArcDisplacement(linearSpeed, 0.f, angularSpeed * dt, dt));
+	if (angularSpeed != 0.f) {
+		float stepAngle = angularSpeed * dt;
+		if (stepAngle != turnAngle) {
+			turnAngle = stepAngle;
+			turn = rotationFromAngle(stepAngle);
+		}
+		angle = angle + stepAngle;
+		rotation = composeTurn(rotation, turn, angle);
+	}
+	if (seaCurrent.x != 0.f || seaCurrent.y != 0.f) {
+		position = position + dt * seaCurrent;
+	}
+	transforms::set(transform, position, angle);
+	collision::moveProxy(collisionProxy, Transform2(position, rotation));
+	wakeDueAircraft(aircraftClock + dt);
+	//One loop per status over its own list, an aircraft changing status is updated once in this step
+	for (int index : aircraftByStatus[TakeOff]) {
+		queueTransition(index, TakeOff, aircraftStorage[index].updateTakeOff(dt));
+	}
+	for (int index : aircraftByStatus[LayInACourse]) {
+		queueTransition(index, LayInACourse, aircraftStorage[index].updateLayInACourse(dt));
+	}
+	for (int index : aircraftByStatus[Returning]) {
+		queueTransition(index, Returning, aircraftStorage[index].updateReturning(dt));
+	}
+	for (int index : aircraftByStatus[Fuelling]) {
+		queueTransition(index, Fuelling, aircraftStorage[index].updateFuelling(dt));
+	}
+	applyTransitions();
+	advanceAircraftClock(dt);
+	checkAircraftReturning();
+	sleepOrbitingAircraft();
+}
+
+
+void Ship::checkAircraftReturning()
+{
+	returnCosts.clear();
+	returnCheckAircraft.clear();
+	for (AircraftStatus status : { TakeOff, LayInACourse }) {
+		for (int index : aircraftByStatus[status]) {
+			if (aircraftStorage[index].isReturnCheckDue()) {
+				aircraftStorage[index].addReturnCheck(returnCosts);
+				returnCheckAircraft.push_back(index);
+			}
+		}
+	}
+	if (returnCheckAircraft.empty()) {
+		return;
+	}
+	returnTimes.resize(returnCheckAircraft.size());
+	returnCosts.interpolate(returnTimes.data());
+	for (int check = 0; check < (int)returnCheckAircraft.size(); check++) {
+		Aircraft& aircraft = aircraftStorage[returnCheckAircraft[check]];
+		AircraftStatus status = aircraft.getStatus();
+		aircraft.finishReturnCheck(returnTimes[check]);
+		queueTransition(returnCheckAircraft[check], status, aircraft.getStatus());
+	}
+	applyTransitions();
+}
+
+
+void Ship::resetAircraftLists()
+{
+	for (auto& list : aircraftByStatus) {
+		list.clear();
+	}
+	sleepingAircraft.clear();
+	nextWakeClock = NO_WAKE;
+	for (int index = 0; index < (int)aircraftStorage.size(); index++) {
+		Aircraft& aircraft = aircraftStorage[index];
+		std::vector<int>& list = aircraft.isAsleep() ? sleepingAircraft : aircraftByStatus[aircraft.getStatus()];
+		aircraftListPositions[index] = (int)list.size();
+		list.push_back(index);
+		if (aircraft.isAsleep()) {
+			nextWakeClock = std::min(nextWakeClock, aircraft.getWakeClock());
+		}
+	}
+	statusTransitions.clear();
+}
+
+
+void Ship::queueTransition(int aircraft, AircraftStatus from, AircraftStatus to)
+{
+	if (from != to) {
+		statusTransitions.push_back(StatusTransition{ aircraft, from, to });
+	}
+}
+
+
+void Ship::applyTransitions()
+{
+	for (auto const& transition : statusTransitions) {
+		moveAircraft(transition.aircraft, aircraftByStatus[transition.from], aircraftByStatus[transition.to]);
+	}
+	statusTransitions.clear();
+}
+
+
+//The last aircraft of from takes the place of the moved one
+void Ship::moveAircraft(int aircraft, std::vector<int>& from, std::vector<int>& to)
+{
+	int position = aircraftListPositions[aircraft];
+	assert(from[position] == aircraft);
+	from[position] = from.back();
+	aircraftListPositions[from[position]] = position;
+	from.pop_back();
+	aircraftListPositions[aircraft] = (int)to.size();
+	to.push_back(aircraft);
+}
+
+
+void Ship::advanceAircraftClock(float dt)
+{
+	aircraftClock += dt;
+	if (aircraftClock < AIRCRAFT_CLOCK_REBASE) {
+		return;
+	}
+	aircraftClock -= AIRCRAFT_CLOCK_REBASE;
+	if (nextWakeClock != NO_WAKE) {
+		nextWakeClock -= AIRCRAFT_CLOCK_REBASE;
+	}
+	for (int index : sleepingAircraft) {
+		aircraftStorage[index].shiftClock(AIRCRAFT_CLOCK_REBASE);
+	}
+}
+
+
+//Aircraft whose return check falls into the coming step fly it updated
+void Ship::wakeDueAircraft(float stepEndClock)
+{
+	if (stepEndClock < nextWakeClock) {
+		return;
+	}
+	nextWakeClock = NO_WAKE;
+	//Backwards, an aircraft leaving the list is replaced by one already visited
+	for (int position = (int)sleepingAircraft.size() - 1; position >= 0; position--) {
+		int index = sleepingAircraft[position];
+		Aircraft& aircraft = aircraftStorage[index];
+		if (aircraft.getWakeClock() <= stepEndClock) {
+			aircraft.wake();
+			moveAircraft(index, sleepingAircraft, aircraftByStatus[LayInACourse]);
+		}
+		else {
+			nextWakeClock = std::min(nextWakeClock, aircraft.getWakeClock());
+		}
+	}
+}
+
+
+void Ship::wakeAllAircraft()
+{
+	while (!sleepingAircraft.empty()) {
+		int index = sleepingAircraft.back();
+		aircraftStorage[index].wake();
+		moveAircraft(index, sleepingAircraft, aircraftByStatus[LayInACourse]);
+	}
+	nextWakeClock = NO_WAKE;
+}
+
+
+void Ship::sleepOrbitingAircraft()
+{
+	std::vector<int>& course = aircraftByStatus[LayInACourse];
+	for (int position = (int)course.size() - 1; position >= 0; position--) {
+		int index = course[position];
+		Aircraft& aircraft = aircraftStorage[index];
+		if (aircraft.isOnOrbit() && !aircraft.isReturnCheckDue()) {
+			aircraft.sleep();
+			nextWakeClock = std::min(nextWakeClock, aircraft.getWakeClock());
+			moveAircraft(index, course, sleepingAircraft);
+		}
+	}
+}
+
+
+void Ship::placeSleepingAircraft()
+{
+	for (int index : sleepingAircraft) {
+		aircraftStorage[index].placeAsleep();
+	}
+}
+
+
+void Ship::updateSalvo(float dt)
+{
+	if (pendingLaunches == 0) {
+		return;
+	}
+	launchTimeout -= dt;
+	//Long steps may let several aircraft off the deck at once
+	while (pendingLaunches > 0 && launchTimeout <= 0.f) {
+		if (!launchAircraft()) {
+			pendingLaunches = 0;
+			return;
+		}
+		pendingLaunches--;
+		launchTimeout += params::ship::SALVO_LAUNCH_INTERVAL;
 	}
 }
 
 
+//Full rudder away from the shore while the ship is closing on it, the helm is kept otherwise
+float Ship::getAvoidanceAngularSpeed(float linearSpeed, float helmAngularSpeed)
+{
+	Vector2 motion = sign(linearSpeed) * rotation.getDirection();
+	if (motion.x * obstacle.gradient.x + motion.y * obstacle.gradient.y >= 0.f) {
+		return helmAngularSpeed;
+	}
+	//Turning left rotates the motion toward its left perpendicular
+	float leftTurnGain = motion.x * obstacle.gradient.y - motion.y * obstacle.gradient.x;
+	return leftTurnGain >= 0.f ? params::ship::ANGULAR_SPEED : -params::ship::ANGULAR_SPEED;
+}
+
+
 void Ship::keyPressed(int key)
 {
 	assert(key >= 0 && key < game::KEY_COUNT);
+	//Auto repeat of a held key doesn't start new salvos
+	if (key == game::KEY_SALVO && !input[key]) {
+		launchSalvo(params::ship::AIRCRAFT_SHIP_CAPACITY);
+	}
 	input[key] = true;
 }
 
@@ -89,19 +358,49 @@ void Ship::mouseClicked(Vector2 worldPosition, bool isLeftButton)
 	if (isLeftButton)
 	{
 		scene::placeGoalMarker(worldPosition.x, worldPosition.y);
-		target = worldPosition;
-		for (auto& aircraft : aircraftStorage) {
-			aircraft.setTarget(target);
-		}
+		setAircraftTarget(worldPosition);
 	}
 	else
 	{
-		bool isTakeoffSuccess;
-		for (auto& aircraft : aircraftStorage) {
-			isTakeoffSuccess = aircraft.Takeoff();
-			if (isTakeoffSuccess) {
-				break;
-			}
+		launchAircraft();
+	}
+}
+
+bool Ship::launchAircraft() {
+	std::vector<int> const& ready = aircraftByStatus[ReadyToFlight];
+	if (ready.empty()) {
+		return false;
+	}
+	int index = ready.back();
+	Aircraft& aircraft = aircraftStorage[index];
+	bool isLaunched = aircraft.Takeoff();
+	assert(isLaunched);
+	//Ready aircraft miss retargets, the patrol goes to the current target
+	aircraft.setTarget(target);
+	queueTransition(index, ReadyToFlight, aircraft.getStatus());
+	applyTransitions();
+	return isLaunched;
+}
+
+void Ship::launchSalvo(int count) {
+	if (count <= 0 || !launchAircraft()) {
+		return;
+	}
+	pendingLaunches = count - 1;
+	launchTimeout = params::ship::SALVO_LAUNCH_INTERVAL;
+}
+
+void Ship::setAircraftTarget(Vector2 worldPosition) {
+	//Flying aircraft have the current target already, enemies repeat it on every think
+	if (worldPosition.x == target.x && worldPosition.y == target.y) {
+		return;
+	}
+	target = worldPosition;
+	wakeAllAircraft();
+	//Returning aircraft ignore targets, fuelling and ready ones get it on takeoff
+	for (AircraftStatus status : { TakeOff, LayInACourse }) {
+		for (int index : aircraftByStatus[status]) {
+			aircraftStorage[index].setTarget(target);
 		}
 	}
 }
@@ -110,6 +409,151 @@ Vector2 Ship::getPosition() {
 	return position;
 }
 
+Vector2 Ship::getStepStartPosition() {
+	return stepStartPosition;
+}
+
 float Ship::getAngle() {
 	return angle;
+}
+
+Rotation2 Ship::getRotation() {
+	return rotation;
+}
+
+transforms::TransformId Ship::getTransform() {
+	return transform;
+}
+
+int Ship::getAircraftCount() {
+	return (int)aircraftStorage.size();
+}
+
+Aircraft& Ship::getAircraft(int index) {
+	assert(index >= 0 && index < (int)aircraftStorage.size());
+	return aircraftStorage[index];
+}
+
+int Ship::getAircraftCount(AircraftStatus status) {
+	int count = (int)aircraftByStatus[status].size();
+	return status == LayInACourse ? count + (int)sleepingAircraft.size() : count;
+}
+
+Aircraft& Ship::getAircraft(AircraftStatus status, int index) {
+	assert(index >= 0 && index < getAircraftCount(status));
+	std::vector<int> const& active = aircraftByStatus[status];
+	if (index >= (int)active.size()) {
+		return aircraftStorage[sleepingAircraft[index - active.size()]];
+	}
+	return aircraftStorage[active[index]];
+}
+
+int Ship::getActiveAircraftCount(AircraftStatus status) {
+	return (int)aircraftByStatus[status].size();
+}
+
+Aircraft& Ship::getActiveAircraft(AircraftStatus status, int index) {
+	assert(index >= 0 && index < (int)aircraftByStatus[status].size());
+	return aircraftStorage[aircraftByStatus[status][index]];
+}
+
+float Ship::getAircraftClock() {
+	return aircraftClock;
+}
+
+uint32_t Ship::hashState() {
+	uint32_t hash = dmath::hashBytes(dmath::HASH_SEED, &position.x, sizeof(position.x));
+	hash = dmath::hashBytes(hash, &position.y, sizeof(position.y));
+	hash = dmath::hashBytes(hash, &angle, sizeof(angle));
+	for (auto& aircraft : aircraftStorage) {
+		hash = aircraft.hashState(hash);
+	}
+	return hash;
+}
+
+void Ship::pushAway(Vector2 offset) {
+	position = position + offset;
+	transforms::set(transform, position, angle);
+	collision::moveProxy(collisionProxy, Transform2(position, rotation));
+	//Ships grinding along a shore are pushed every step, sleeping orbits keep sleeping
+	//unless the jump pulls their return check into the coming step
+	float returnDelay = getReturnTimeBoundSlope() * dmath::sqrt(offset.lengthSquare());
+	for (auto& aircraft : aircraftStorage) {
+		if (aircraft.isAsleep()) {
+			aircraft.advanceReturnCheck(returnDelay);
+			nextWakeClock = std::min(nextWakeClock, aircraft.getWakeClock());
+		}
+		else {
+			aircraft.recheckReturningTime();
+		}
+	}
+}
+
+void Ship::setSeaCurrent(Vector2 current) {
+	seaCurrent = current;
+}
+
+void Ship::setObstacle(ObstacleSample const& sample) {
+	obstacle = sample;
+}
+
+void Ship::saveStateOnUpdate(ShipState* state, AircraftState* aircraftStates) {
+	savedState = state;
+	savedAircraftStates = aircraftStates;
+}
+
+void Ship::saveState() {
+	ShipState& state = *savedState;
+	state.position = position;
+	state.stepStartPosition = stepStartPosition;
+	state.target = target;
+	state.seaCurrent = seaCurrent;
+	state.obstacle = obstacle;
+	state.angle = angle;
+	state.rotation = rotation;
+	for (int key = 0; key < game::KEY_COUNT; key++) {
+		state.input[key] = input[key] ? 1u : 0u;
+	}
+	state.pendingLaunches = pendingLaunches;
+	state.launchTimeout = launchTimeout;
+	state.aircraftClock = aircraftClock;
+	for (int index = 0; index < (int)aircraftStorage.size(); index++) {
+		aircraftStorage[index].saveState(savedAircraftStates[index]);
+	}
+	savedState = nullptr;
+	savedAircraftStates = nullptr;
+}
+
+void Ship::restoreState(ShipState const& state, AircraftState const* aircraftStates) {
+	position = state.position;
+	stepStartPosition = state.stepStartPosition;
+	target = state.target;
+	seaCurrent = state.seaCurrent;
+	obstacle = state.obstacle;
+	angle = state.angle;
+	rotation = state.rotation;
+	for (int key = 0; key < game::KEY_COUNT; key++) {
+		input[key] = state.input[key] != 0;
+	}
+	pendingLaunches = state.pendingLaunches;
+	launchTimeout = state.launchTimeout;
+	//Sleeping aircraft are evaluated at the clock while they are restored
+	aircraftClock = state.aircraftClock;
+	transforms::set(transform, position, angle);
+	collision::moveProxy(collisionProxy, Transform2(position, rotation));
+	for (int index = 0; index < (int)aircraftStorage.size(); index++) {
+		aircraftStorage[index].restoreState(aircraftStates[index]);
+	}
+	resetAircraftLists();
+}
+
+void Ship::shiftOrigin(Vector2 offset) {
+	position = position - offset;
+	stepStartPosition = stepStartPosition - offset;
+	target = target - offset;
+	transforms::set(transform, position, angle);
+	collision::moveProxy(collisionProxy, Transform2(position, rotation));
+	for (auto& aircraft : aircraftStorage) {
+		aircraft.shiftOrigin(offset);
+	}
 }
\ No newline at end of file
@@ -1,33 +1,141 @@
 #pragma once
 #include "../framework/game.hpp"
 #include "aircraft.h"
+#include "collision.h"
+#include "distance_field.h"
+#include "return_cost.h"
+#include "transforms.h"
 #include "supporting_function.h"
 #include <vector>
 
 class Aircraft;
 
+//Ship part of a checkpoint, its aircraft are saved one by one next to it
+struct ShipState
+{
+	Vector2 position;
+	Vector2 stepStartPosition;
+	Vector2 target;
+	Vector2 seaCurrent;
+	ObstacleSample obstacle;
+	float angle;
+	Rotation2 rotation;
+	uint32_t input[game::KEY_COUNT];
+	int32_t pendingLaunches;
+	float launchTimeout;
+	float aircraftClock;
+};
+static_assert(std::is_trivially_copyable<ShipState>::value, "ship states are saved as raw bytes");
+
 class Ship
 {
 public:
 	Ship();
 
-	void init();
+	void init(Vector2 startPosition = Vector2(), float startAngle = 0.f);
 	void deinit();
 	void update(float dt);
 	void keyPressed(int key);
 	void keyReleased(int key);
 	void mouseClicked(Vector2 worldPosition, bool isLeftButton);
+	//The aircraft that became ready last takes off, false with an empty hangar
+	bool launchAircraft();
+	//The first aircraft takes off at once, the rest one by one as the deck clears,
+	//a salvo ends early when the hangar runs empty
+	void launchSalvo(int count);
+	//Only airborne aircraft turn to the target, the others get it when they take off
+	void setAircraftTarget(Vector2 worldPosition);
 	Vector2 getPosition();
+	//Position before the current update moved the ship
+	Vector2 getStepStartPosition();
 	float getAngle();
+	Rotation2 getRotation();
+	//Aircraft on deck follow it
+	transforms::TransformId getTransform();
+	int getAircraftCount();
+	Aircraft& getAircraft(int index);
+	//Aircraft in the status, in no particular order, sleeping ones are counted as LayInACourse
+	int getAircraftCount(AircraftStatus status);
+	Aircraft& getAircraft(AircraftStatus status, int index);
+	//Aircraft in the status updated every step, the sleeping ones are left out
+	int getActiveAircraftCount(AircraftStatus status);
+	Aircraft& getActiveAircraft(AircraftStatus status, int index);
+	//Simulated time of the aircraft, sleeping ones fly their orbits from it
+	float getAircraftClock();
+	//Sleeping aircraft aren't placed by updates, only before drawing
+	void placeSleepingAircraft();
+	uint32_t hashState();
+	void pushAway(Vector2 offset);
+	//Drift added to the ship own motion, it must not exceed params::world::MAXIMAL_SEA_CURRENT
+	void setSeaCurrent(Vector2 current);
+	//Nearest shore at the ship position, the ship turns away when heading into it
+	void setObstacle(ObstacleSample const& sample);
+	//Moves the ship and its aircraft by -offset, nothing changes relative to the world
+	void shiftOrigin(Vector2 offset);
+	//The next update saves the ship and its aircraft before moving anything, while their
+	//memory is being touched anyway. aircraftStates gets getAircraftCount() states in storage order
+	void saveStateOnUpdate(ShipState* state, AircraftState* aircraftStates);
+	//aircraftStates holds getAircraftCount() states in storage order
+	void restoreState(ShipState const& state, AircraftState const* aircraftStates);
 
 private:
 	scene::Mesh* mesh;
+	collision::ProxyId collisionProxy;
+	transforms::TransformId transform;
 	Vector2 position;
+	Vector2 stepStartPosition;
 	Vector2 target;
+	Vector2 seaCurrent;
+	ObstacleSample obstacle;
 	float angle;
+	//Follows angle, turned by turn only when the ship turns
+	Rotation2 rotation;
+	//Rotation of one turn step, rebuilt only when angularSpeed * dt changes
+	float turnAngle;
+	Rotation2 turn;
 
 	bool input[game::KEY_COUNT];
 	std::vector<Aircraft> aircraftStorage;
+	//Indices into aircraftStorage, every aircraft is in the list of its status. Status
+	//changes during an update are queued and the lists change only between phases
+	std::vector<int> aircraftByStatus[AircraftStatus::Count];
+	//Aircraft on steady orbits, out of the LayInACourse list until they wake
+	std::vector<int> sleepingAircraft;
+	//Index of every aircraft in its list, so it leaves the list in constant time
+	std::vector<int> aircraftListPositions;
+	float aircraftClock;
+	//No sleeping aircraft wakes for its return check before this clock
+	float nextWakeClock;
+	struct StatusTransition
+	{
+		int aircraft;
+		AircraftStatus from;
+		AircraftStatus to;
+	};
+	std::vector<StatusTransition> statusTransitions;
+	//Return checks of the aircraft due this update, answered by one batch lookup
+	ReturnCostBatch returnCosts;
+	std::vector<int> returnCheckAircraft;
+	std::vector<float> returnTimes;
+	//Salvo launches still to come and the time until the next one
+	int pendingLaunches;
+	float launchTimeout;
+	//Set until the next update saves the state there
+	ShipState* savedState;
+	AircraftState* savedAircraftStates;
+
+	float getAvoidanceAngularSpeed(float linearSpeed, float helmAngularSpeed);
+	void checkAircraftReturning();
+	void resetAircraftLists();
+	void queueTransition(int aircraft, AircraftStatus from, AircraftStatus to);
+	void applyTransitions();
+	void moveAircraft(int aircraft, std::vector<int>& from, std::vector<int>& to);
+	void advanceAircraftClock(float dt);
+	void wakeDueAircraft(float stepEndClock);
+	void wakeAllAircraft();
+	void sleepOrbitingAircraft();
+	void updateSalvo(float dt);
+	void saveState();
 };
 
 class ship
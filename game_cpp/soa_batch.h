@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+
+//-------------------------------------------------------
+//	Float columns of a batch that looks its inputs up one
+//	by one and then runs plain arithmetic over whole
+//	columns. Kernels take the columns as WOTS_RESTRICT
+//	pointers, otherwise the compiler has to assume any
+//	two of them overlap and keeps the loop scalar.
+//-------------------------------------------------------
+
+#if defined(_MSC_VER)
+#define WOTS_RESTRICT __restrict
+#else
+#define WOTS_RESTRICT __restrict__
+#endif
+
+template <int ColumnCount>
+class SoaColumns
+{
+public:
+	void clear()
+	{
+		for (auto& column : _columns) {
+			column.clear();
+		}
+	}
+
+	void reserve(int count)
+	{
+		for (auto& column : _columns) {
+			column.reserve(count);
+		}
+	}
+
+	//Output columns are sized before a kernel writes them by index
+	void resize(int count)
+	{
+		for (auto& column : _columns) {
+			column.resize(count);
+		}
+	}
+
+	//One value per column
+	void add(float const (&row)[ColumnCount])
+	{
+		for (int index = 0; index < ColumnCount; index++) {
+			_columns[index].push_back(row[index]);
+		}
+	}
+
+	int size() const
+	{
+		return (int)_columns[0].size();
+	}
+
+	float const* get(int column) const
+	{
+		return _columns[column].data();
+	}
+
+	float* get(int column)
+	{
+		return _columns[column].data();
+	}
+
+private:
+	std::vector<float> _columns[ColumnCount];
+};
+
+inline float interpolateLinear(float from, float to, float fraction)
+{
+	return from + (to - from) * fraction;
+}
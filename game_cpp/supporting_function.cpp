@@ -1,43 +1,42 @@
 #include "supporting_function.h"
 
-Vector2::Vector2() :
-	x(0.f),
-	y(0.f)
-{
-}
-
-
-Vector2::Vector2(float vx, float vy) :
-	x(vx),
-	y(vy)
-{
-}
-
+#include <cmath>
 
-Vector2::Vector2(Vector2 const& other) :
-	x(other.x),
-	y(other.y)
+#ifdef WOTS_TUNABLE_PARAMS
+namespace params
 {
+	namespace aircraft
+	{
+#define WOTS_DEFINE_PARAM( name, value ) thread_local float name = value;
+		WOTS_AIRCRAFT_TUNABLE_PARAMS( WOTS_DEFINE_PARAM )
+#undef WOTS_DEFINE_PARAM
+	}
 }
+#endif
 
-float Vector2::lengthSquare() {
-	return x * x + y * y;
-}
-
-
-Vector2 operator + (Vector2 const& left, Vector2 const& right)
-{
-	return Vector2(left.x + right.x, left.y + right.y);
-}
-
-Vector2 operator- (Vector2 const& left, Vector2 const& right)
-{
-	return left + (-1) * right;
-}
+//Below it the closed form loses the a * (1 - cos) / angle^2 terms to cancellation, so Taylor series are used
+constexpr float ARC_SERIES_ANGLE = 0.1f;
 
-Vector2 operator * (float left, Vector2 const& right)
-{
-	return Vector2(left * right.x, left * right.y);
+Vector2 getArcDisplacement(float speed, float acceleration, float turnAngle, float time) {
+	//Integral of (speed + acceleration * t) * (cos, sin)(turnAngle * t / time) over [0; time]
+	float sinRatio, versinRatio, versinSquareRatio, lagRatio;
+	if (std::abs(turnAngle) < ARC_SERIES_ANGLE) {
+		float square = turnAngle * turnAngle;
+		sinRatio = 1.f - square / 6.f + square * square / 120.f;
+		versinRatio = turnAngle * (0.5f - square / 24.f);
+		versinSquareRatio = 0.5f - square / 24.f + square * square / 720.f;
+		lagRatio = turnAngle * (1.f / 3.f - square / 30.f);
+	}
+	else {
+		Rotation2 turn = rotationFromAngle(turnAngle);
+		sinRatio = turn.sine / turnAngle;
+		versinRatio = (1.f - turn.cosine) / turnAngle;
+		versinSquareRatio = versinRatio / turnAngle;
+		lagRatio = (turn.sine - turnAngle * turn.cosine) / (turnAngle * turnAngle);
+	}
+	float timeSquare = time * time;
+	return Vector2(speed * time * sinRatio + acceleration * timeSquare * (sinRatio - versinSquareRatio),
+		speed * time * versinRatio + acceleration * timeSquare * lagRatio);
 }
 
 bool isVectorsClockviseOrder(Vector2 const& first, Vector2 const& second) {
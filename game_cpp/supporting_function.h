@@ -1,6 +1,9 @@
 #pragma once
 #include "../framework/scene.hpp"
 #include "../framework/game.hpp"
+#include "deterministic_math.h"
+
+#include <type_traits>
 
 //-------------------------------------------------------
 //	game parameters
@@ -14,6 +17,8 @@ namespace params
 		constexpr float PI_CONST = 3.141593f;
 		constexpr float PATROL_RADIUS_VARIATION = 1.e-4f;
 		constexpr float ON_COURSE_ANGLE_VARIATION = 1.e-4f;
+		//Squared length error of a composed rotation that gets it rebuilt from its angle
+		constexpr float ROTATION_LENGTH_DRIFT = 1.e-5f;
 	}
 	namespace ship
 	{
@@ -22,28 +27,94 @@ namespace params
 		constexpr float LANDING_RADIUS = 0.2f;
 		constexpr float FUELLING_COEFFICIENT = 3.f;
 		constexpr int AIRCRAFT_SHIP_CAPACITY = 5;
+		//Time between salvo launches, the previous aircraft has left the deck by then
+		constexpr float SALVO_LAUNCH_INTERVAL = 0.5f;
+		constexpr char const* MESH_NAME = "ship";
+		//Ship center distance to a shore where steering away overrides the helm
+		constexpr float OBSTACLE_AVOID_DISTANCE = 1.2f;
 	}
 
 	namespace aircraft
 	{
 		constexpr float LINEAR_SPEED = 2.f;
-		constexpr float LINEAR_ACCELERATION = 0.7f;
 		constexpr float ANGULAR_SPEED = 2.5f;
 		constexpr float MAXIMAL_FLIGHT_TIME = 30.f;
+		constexpr char const* MESH_NAME = "aircraft";
+		//Distance to a shore where the course bends along it
+		constexpr float OBSTACLE_AVOID_DISTANCE = 0.5f;
+
+		// Tuning parameters: name, default value.
+		// LANDING_SPEED_COEFFICIENT is relativly to ship LINEAR_SPEED;
+#define WOTS_AIRCRAFT_TUNABLE_PARAMS( PARAM ) \
+		PARAM( LINEAR_ACCELERATION, 0.7f ) \
+		PARAM( TAKEOFF_RADIUS, 0.4f ) \
+		PARAM( TAKEOFF_SPEED_COEFICIENT, 0.25f ) \
+		PARAM( PATROL_RADIUS, 0.7f ) \
+		PARAM( PATROL_SPEED_COEFFICIENT, 0.6f ) \
+		PARAM( LANDING_SPEED_COEFFICIENT, 1.5f )
+
+#ifdef WOTS_TUNABLE_PARAMS
+		// Parameter sweep injects values at runtime, every worker thread simulates with its own set
+#define WOTS_DECLARE_PARAM( name, value ) extern thread_local float name;
+#else
+#define WOTS_DECLARE_PARAM( name, value ) constexpr float name = value;
+#endif
+		WOTS_AIRCRAFT_TUNABLE_PARAMS( WOTS_DECLARE_PARAM )
+#undef WOTS_DECLARE_PARAM
+	}
+
+	namespace ai
+	{
+		constexpr int ENEMY_SHIP_COUNT = 3;
+		constexpr float SPAWN_RADIUS_X = 7.f;
+		constexpr float SPAWN_RADIUS_Y = 5.f;
 
-		constexpr float TAKEOFF_RADIUS = 0.4f;
-		constexpr float TAKEOFF_SPEED_COEFICIENT = 0.25f;
+		// Think work allowed per frame, deterministic builds are capped by count only
+		constexpr float THINK_BUDGET_MICROSECONDS = 500.f;
+		constexpr int MAX_THINKS_PER_FRAME = 16;
 
-		constexpr float PATROL_RADIUS = 0.7f;
-		constexpr float PATROL_SPEED_COEFFICIENT = 0.6f;
+		constexpr float NEAR_THINK_INTERVAL = 0.1f;
+		constexpr float FAR_THINK_INTERVAL = 0.5f;
+		constexpr float NEAR_DISTANCE = 4.f;
+		constexpr float THREAT_RADIUS = 1.5f;
 
-		// Relativly to ship LINEAR_SPEED;
-		constexpr float LANDING_SPEED_COEFFICIENT = 1.5f;
+		constexpr float STANDOFF_DISTANCE = 5.f;
+		constexpr float STANDOFF_TOLERANCE = 1.f;
+		constexpr float STRIKE_RANGE = 6.f;
+		constexpr float STRIKE_COOLDOWN = 3.f;
+		constexpr float STEERING_DEAD_ZONE = 0.05f;
+	}
+
+	namespace checkpoint
+	{
+		//Incremental snapshots of every ship and aircraft, for resuming soak runs, written
+		//when the command line names a file. Simulated seconds between checkpoints,
+		//a busy writer postpones the next one
+		constexpr float INTERVAL = 10.f;
+	}
+
+	namespace world
+	{
+		//Default of --world, open ocean without islands when the file is missing
+		constexpr char const* FILE_PATH = "world.wsw";
+		//Chunks loaded around every carrier, in chunks from the carrier one
+		constexpr int ACTIVE_RADIUS_CHUNKS = 1;
+		//Origin moves to the player once it gets this far, in chunk sizes
+		constexpr float REBASE_DISTANCE_CHUNKS = 1.f;
+		//World files never store a stronger sea current
+		constexpr float MAXIMAL_SEA_CURRENT = 0.15f;
+		constexpr float SPAWN_SEARCH_RADIUS = 10.f;
+		//Islands touching one ship reserved up front, more only cost an allocation
+		constexpr int MAXIMAL_NEARBY_ISLANDS = 16;
+		//Island distance fields saturate this far from shores, it must not exceed the chunk size
+		constexpr float OBSTACLE_RANGE = 2.f;
+		constexpr float OBSTACLE_CELL_SIZE = 0.25f;
 	}
 }
 
 //-------------------------------------------------------
-//	Basic Vector2 class
+//	Basic math: constexpr and trivially copyable, so values
+//	are usable in constant expressions and copied as raw floats
 //-------------------------------------------------------
 
 class Vector2
@@ -52,15 +123,94 @@ public:
 	float x;
 	float y;
 
-	Vector2();
-	Vector2(float vx, float vy);
-	Vector2(Vector2 const &other);
+	constexpr Vector2() : x(0.f), y(0.f) {}
+	constexpr Vector2(float vx, float vy) : x(vx), y(vy) {}
 	//sqrt is not efficiency operation;
-	float lengthSquare();
+	constexpr float lengthSquare() const { return x * x + y * y; }
 };
 
-Vector2 operator+ (Vector2 const& left, Vector2 const& right);
-Vector2 operator- (Vector2 const& left, Vector2 const& right);
-Vector2 operator* (float left, Vector2 const& right);
+constexpr Vector2 operator+ (Vector2 const& left, Vector2 const& right)
+{
+	return Vector2(left.x + right.x, left.y + right.y);
+}
+
+constexpr Vector2 operator- (Vector2 const& left, Vector2 const& right)
+{
+	return Vector2(left.x - right.x, left.y - right.y);
+}
+
+constexpr Vector2 operator* (float left, Vector2 const& right)
+{
+	return Vector2(left * right.x, left * right.y);
+}
+
+//Angle kept as its cosine and sine, turning a vector or another rotation takes multiply-adds only
+class Rotation2
+{
+public:
+	float cosine;
+	float sine;
+
+	constexpr Rotation2() : cosine(1.f), sine(0.f) {}
+	constexpr Rotation2(float cosine, float sine) : cosine(cosine), sine(sine) {}
+	//Unit vector along the angle
+	constexpr Vector2 getDirection() const { return Vector2(cosine, sine); }
+	constexpr Vector2 rotate(Vector2 const& vector) const
+	{
+		return Vector2(cosine * vector.x - sine * vector.y, sine * vector.x + cosine * vector.y);
+	}
+	constexpr Rotation2 inverse() const { return Rotation2(cosine, -sine); }
+};
+
+//Rotation by the sum of both angles
+constexpr Rotation2 operator* (Rotation2 const& left, Rotation2 const& right)
+{
+	return Rotation2(left.cosine * right.cosine - left.sine * right.sine, left.sine * right.cosine + left.cosine * right.sine);
+}
+
+//Rotation followed by translation, maps local space of a body to its parent space
+class Transform2
+{
+public:
+	Vector2 position;
+	Rotation2 rotation;
+
+	constexpr Transform2() : position(), rotation() {}
+	constexpr Transform2(Vector2 const& position, Rotation2 const& rotation) : position(position), rotation(rotation) {}
+	constexpr Vector2 apply(Vector2 const& point) const { return position + rotation.rotate(point); }
+};
+
+//Local space of right mapped straight to the parent space of left
+constexpr Transform2 operator* (Transform2 const& left, Transform2 const& right)
+{
+	return Transform2(left.apply(right.position), left.rotation * right.rotation);
+}
+
+static_assert(std::is_trivially_copyable<Vector2>::value, "Vector2 is copied as raw floats");
+static_assert(std::is_trivially_copyable<Rotation2>::value, "Rotation2 is copied as raw floats");
+static_assert(std::is_trivially_copyable<Transform2>::value, "Transform2 is copied as raw floats");
+
+//The only place where angles turn into trigonometry, simulation code keeps rotations around instead
+inline Rotation2 rotationFromAngle(float angle)
+{
+	return Rotation2(dmath::cos(angle), dmath::sin(angle));
+}
+
+//Turns a rotation kept next to its angle by a cached step rotation, a multiply-add instead of
+//trigonometry. Rounding slowly moves the product off unit length, then it is rebuilt from angle
+inline Rotation2 composeTurn(Rotation2 const& rotation, Rotation2 const& turn, float angle)
+{
+	Rotation2 turned = rotation * turn;
+	float lengthError = turned.cosine * turned.cosine + turned.sine * turned.sine - 1.f;
+	if (lengthError > params::precision::ROTATION_LENGTH_DRIFT || lengthError < -params::precision::ROTATION_LENGTH_DRIFT) {
+		return rotationFromAngle(angle);
+	}
+	return turned;
+}
+
+//Exact path of a body moving for time with constant acceleration and constant turn,
+//speed is the start one and turnAngle the heading change over the whole time.
+//The result is in the frame of the start heading, x along it
+Vector2 getArcDisplacement(float speed, float acceleration, float turnAngle, float time);
 bool isVectorsClockviseOrder(Vector2 const& first, Vector2 const& second);
 int sign(float number);
@@ -0,0 +1,289 @@
+#include "telemetry.h"
+#include "telemetry_format.h"
+#include "../framework/allocation_tracker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	using namespace telemetry::format;
+
+	//Chunk is handed to the writer after this many rows or frames, whatever comes first
+	constexpr size_t MAX_CHUNK_ROWS = 1 << 18;
+	constexpr size_t MAX_CHUNK_FRAMES = 600;
+	constexpr auto WRITER_IDLE_SLEEP = std::chrono::milliseconds(1);
+
+	//Raw column values of consecutive frames.
+	//Column vectors are sized up front and filled by index, so recording
+	//a row is a handful of stores without allocations
+	struct Chunk
+	{
+		std::vector<float> frameTimes;
+		std::vector<uint32_t> frameRows;
+		std::vector<float> columns[FLOAT_COLUMN_COUNT];
+		std::vector<uint8_t> statuses;
+		size_t rowCount = 0;
+
+		void clear()
+		{
+			frameTimes.clear();
+			frameRows.clear();
+			rowCount = 0;
+		}
+
+		void reserve(size_t rows)
+		{
+			frameTimes.reserve(MAX_CHUNK_FRAMES);
+			frameRows.reserve(MAX_CHUNK_FRAMES);
+			for (auto& column : columns) {
+				column.resize(rows);
+			}
+			statuses.resize(rows);
+		}
+
+		size_t rows() const
+		{
+			return rowCount;
+		}
+	};
+
+	Chunk chunks[2];
+	Chunk* front = &chunks[0];
+	Chunk* back = &chunks[1];
+	//Set by the simulation thread when back chunk is ready, cleared by the writer when it is written
+	std::atomic<bool> isBackFull(false);
+	std::atomic<bool> isStopping(false);
+	std::thread writer;
+	FILE* file = nullptr;
+	int droppedChunks = 0;
+	int writtenChunks = 0;
+
+
+	void appendU32(std::vector<uint8_t>& bytes, uint32_t value)
+	{
+		for (int shift = 0; shift < 32; shift += 8) {
+			bytes.push_back((uint8_t)(value >> shift));
+		}
+	}
+
+
+	uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+
+	void encodeFloatColumn(std::vector<float> const& values, Chunk const& chunk, std::vector<uint32_t>& previous, std::vector<uint8_t>& bytes)
+	{
+		std::fill(previous.begin(), previous.end(), 0u);
+		size_t value = 0;
+		for (uint32_t rows : chunk.frameRows) {
+			if (previous.size() < rows) {
+				previous.resize(rows, 0u);
+			}
+			for (uint32_t row = 0; row < rows; row++, value++) {
+				uint32_t bits = floatBits(values[value]);
+				int32_t delta = (int32_t)(bits - previous[row]);
+				previous[row] = bits;
+				uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+				while (zigzag >= 0x80) {
+					bytes.push_back((uint8_t)(zigzag | 0x80));
+					zigzag >>= 7;
+				}
+				bytes.push_back((uint8_t)zigzag);
+			}
+		}
+	}
+
+
+	void encodePacked3Bits(std::vector<uint8_t> const& values, size_t count, std::vector<uint8_t>& bytes)
+	{
+		uint32_t accumulator = 0;
+		int bitCount = 0;
+		for (size_t index = 0; index < count; index++) {
+			accumulator |= (uint32_t)(values[index] & 7) << bitCount;
+			bitCount += 3;
+			while (bitCount >= 8) {
+				bytes.push_back((uint8_t)accumulator);
+				accumulator >>= 8;
+				bitCount -= 8;
+			}
+		}
+		if (bitCount > 0) {
+			bytes.push_back((uint8_t)accumulator);
+		}
+	}
+
+
+	void writeHeader()
+	{
+		std::vector<uint8_t> bytes(FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+		appendU32(bytes, VERSION);
+		appendU32(bytes, ColumnCount);
+		for (int column = 0; column < ColumnCount; column++) {
+			size_t nameLength = std::strlen(COLUMN_NAMES[column]);
+			bytes.push_back(getEncoding(column));
+			bytes.push_back((uint8_t)nameLength);
+			bytes.insert(bytes.end(), COLUMN_NAMES[column], COLUMN_NAMES[column] + nameLength);
+		}
+		std::fwrite(bytes.data(), 1, bytes.size(), file);
+	}
+
+
+	//Runs on the writer thread only
+	void writeChunk(Chunk const& chunk, std::vector<uint32_t>& previous, std::vector<uint8_t>& bytes, std::vector<uint8_t>& columnBytes)
+	{
+		bytes.clear();
+		appendU32(bytes, CHUNK_MAGIC);
+		appendU32(bytes, (uint32_t)chunk.frameTimes.size());
+		appendU32(bytes, (uint32_t)chunk.rows());
+		for (size_t frame = 0; frame < chunk.frameTimes.size(); frame++) {
+			appendU32(bytes, floatBits(chunk.frameTimes[frame]));
+			appendU32(bytes, chunk.frameRows[frame]);
+		}
+
+		for (int column = 0; column < ColumnCount; column++) {
+			columnBytes.clear();
+			if (column == Status) {
+				encodePacked3Bits(chunk.statuses, chunk.rows(), columnBytes);
+			}
+			else {
+				encodeFloatColumn(chunk.columns[column], chunk, previous, columnBytes);
+			}
+			appendU32(bytes, (uint32_t)columnBytes.size());
+			bytes.insert(bytes.end(), columnBytes.begin(), columnBytes.end());
+		}
+		std::fwrite(bytes.data(), 1, bytes.size(), file);
+	}
+
+
+	void runWriter()
+	{
+		allocations::Scope allocationScope(allocations::SUBSYSTEM_BACKGROUND);
+		std::vector<uint32_t> previous;
+		std::vector<uint8_t> bytes;
+		std::vector<uint8_t> columnBytes;
+		while (true) {
+			if (isBackFull.load(std::memory_order_acquire)) {
+				writeChunk(*back, previous, bytes, columnBytes);
+				back->clear();
+				isBackFull.store(false, std::memory_order_release);
+				continue;
+			}
+			if (isStopping.load(std::memory_order_acquire)) {
+				return;
+			}
+			std::this_thread::sleep_for(WRITER_IDLE_SLEEP);
+		}
+	}
+
+
+	//Never waits for the writer unless asked to
+	void submitFront(bool isWaiting)
+	{
+		if (front->frameTimes.empty()) {
+			return;
+		}
+		while (isWaiting && isBackFull.load(std::memory_order_acquire)) {
+			std::this_thread::sleep_for(WRITER_IDLE_SLEEP);
+		}
+		if (isBackFull.load(std::memory_order_acquire)) {
+			droppedChunks++;
+			front->clear();
+			return;
+		}
+		std::swap(front, back);
+		writtenChunks++;
+		isBackFull.store(true, std::memory_order_release);
+	}
+}
+
+
+namespace telemetry
+{
+	bool start(char const* path)
+	{
+		assert(!file);
+		file = std::fopen(path, "wb");
+		if (!file) {
+			std::fprintf(stderr, "telemetry: can't open %s\n", path);
+			return false;
+		}
+		writeHeader();
+		for (auto& chunk : chunks) {
+			chunk.clear();
+			chunk.reserve(MAX_CHUNK_ROWS);
+		}
+		droppedChunks = 0;
+		writtenChunks = 0;
+		isBackFull.store(false);
+		isStopping.store(false);
+		writer = std::thread(runWriter);
+		return true;
+	}
+
+
+	void stop()
+	{
+		if (!file) {
+			return;
+		}
+		submitFront(true);
+		isStopping.store(true, std::memory_order_release);
+		writer.join();
+		std::fclose(file);
+		file = nullptr;
+		std::printf("telemetry: %d chunks written, %d dropped\n", writtenChunks, droppedChunks);
+	}
+
+
+	bool isRunning()
+	{
+		return file != nullptr;
+	}
+
+
+	void beginFrame(float time)
+	{
+		assert(file);
+		front->frameTimes.push_back(time);
+		front->frameRows.push_back(0);
+	}
+
+
+	void record(AircraftSample const& sample)
+	{
+		size_t row = front->rowCount;
+		if (row == front->statuses.size()) {
+			//A single frame outgrew the chunk, the only case the simulation thread allocates
+			front->reserve(row * 2);
+		}
+		front->columns[PositionX][row] = sample.position.x;
+		front->columns[PositionY][row] = sample.position.y;
+		front->columns[Speed][row] = sample.speed;
+		front->columns[Angle][row] = sample.angle;
+		front->columns[FlightTime][row] = sample.flightTime;
+		front->columns[DistanceToMothership][row] = sample.distanceToMothership;
+		front->statuses[row] = (uint8_t)sample.status;
+		front->rowCount = row + 1;
+		front->frameRows.back()++;
+	}
+
+
+	void endFrame()
+	{
+		if (front->rows() >= MAX_CHUNK_ROWS || front->frameTimes.size() >= MAX_CHUNK_FRAMES) {
+			submitFront(false);
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "supporting_function.h"
+
+//-------------------------------------------------------
+//	Per-frame aircraft telemetry for offline analysis.
+//	Simulation thread only appends raw values to the current chunk,
+//	full chunks are handed to a background thread that compresses
+//	and writes them. When the writer falls behind a chunk is dropped
+//	instead of stalling the simulation.
+//-------------------------------------------------------
+
+namespace telemetry
+{
+	struct AircraftSample
+	{
+		Vector2 position;
+		float speed;
+		float angle;
+		float flightTime;
+		int status;
+		float distanceToMothership;
+	};
+
+	bool start(char const* path);
+	void stop();
+	bool isRunning();
+
+	void beginFrame(float time);
+	void record(AircraftSample const& sample);
+	void endFrame();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+//-------------------------------------------------------
+//	Telemetry file layout, all values little-endian.
+//
+//	header:	char magic[8], u32 version, u32 columnCount,
+//			columnCount * { u8 encoding, u8 nameLength, char name[nameLength] }
+//	chunk:	u32 CHUNK_MAGIC, u32 frameCount, u32 rowCount,
+//			frameCount * { f32 time, u32 rows },
+//			columnCount * { u32 byteSize, u8 data[byteSize] }
+//
+//	Rows of a frame are aircraft in a stable order. Every chunk decodes on
+//	its own: delta encoded columns start from zero at the chunk begin.
+//-------------------------------------------------------
+
+namespace telemetry
+{
+	namespace format
+	{
+		constexpr char FILE_MAGIC[8] = { 'W', 'O', 'T', 'S', 'T', 'L', 'M', '1' };
+		constexpr uint32_t VERSION = 1;
+		constexpr uint32_t CHUNK_MAGIC = 0x4b4e4843;
+
+		enum Encoding : uint8_t {
+			//Float bits minus bits of the same row in the previous frame, zigzag varint
+			FloatDelta = 0,
+			//Three bits per value, least significant bit first
+			Packed3Bits = 1
+		};
+
+		enum Column {
+			PositionX,
+			PositionY,
+			Speed,
+			Angle,
+			FlightTime,
+			DistanceToMothership,
+			Status,
+			ColumnCount
+		};
+
+		constexpr int FLOAT_COLUMN_COUNT = Status;
+
+		constexpr char const* COLUMN_NAMES[ColumnCount] = {
+			"position_x", "position_y", "speed", "angle", "flight_time", "distance_to_mothership", "status"
+		};
+
+		inline Encoding getEncoding(int column) {
+			return column == Status ? Packed3Bits : FloatDelta;
+		}
+	}
+}
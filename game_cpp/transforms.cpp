@@ -0,0 +1,311 @@
+#include "transforms.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace
+{
+	constexpr int CLEAN = -1;
+
+	struct Slot
+	{
+		//World pose
+		transforms::Transform transform;
+		//World rotation resolved for rotationAngle, children of a turned parent
+		//rebuild it once and compose with it instead of the parent angle
+		Rotation2 rotation;
+		float rotationAngle;
+		//Pose in the parent space, meaningful only with a parent
+		transforms::Transform local;
+		Rotation2 localRotation;
+		scene::Mesh* mesh;
+		//Index in changes while the transform is dirty, CLEAN otherwise
+		int changeIndex;
+		transforms::TransformId parent;
+		int childCount;
+		//Generation in which the world pose last changed, children of a parent
+		//that didn't change in the current generation keep their world pose
+		uint32_t changedGeneration;
+		bool isLocalChanged;
+		//Guards against duplicates while the hierarchy is rebuilt
+		bool isListed;
+		bool isAlive;
+	};
+
+	struct HierarchyEntry
+	{
+		int depth;
+		transforms::TransformId id;
+	};
+
+	//Each sweep worker resolves its own hierarchy, nothing here is shared between threads
+	thread_local std::vector<Slot> slots;
+	thread_local std::vector<transforms::TransformId> freeSlots;
+	thread_local std::vector<transforms::Change> changes;
+	//Every transform with a parent, parents before children and by id within a depth,
+	//so a resolve walks the slots forward. Attached transforms are appended and the
+	//list is sorted again before the next resolve
+	thread_local std::vector<transforms::TransformId> hierarchy;
+	thread_local std::vector<HierarchyEntry> hierarchyEntries;
+	thread_local bool isHierarchyChanged = false;
+	//Advances with every resolve
+	thread_local uint32_t generation = 1;
+
+
+	Slot& getSlot(transforms::TransformId id)
+	{
+		assert(id >= 0 && id < (transforms::TransformId)slots.size() && slots[id].isAlive);
+		return slots[id];
+	}
+
+
+	Rotation2 const& getRotation(Slot& slot)
+	{
+		if (slot.rotationAngle != slot.transform.angle) {
+			slot.rotation = rotationFromAngle(slot.transform.angle);
+			slot.rotationAngle = slot.transform.angle;
+		}
+		return slot.rotation;
+	}
+
+
+	void setWorld(transforms::TransformId id, Slot& slot, Vector2 position, float angle)
+	{
+		if (slot.transform.position.x == position.x && slot.transform.position.y == position.y && slot.transform.angle == angle) {
+			return;
+		}
+		slot.transform.position = position;
+		slot.transform.angle = angle;
+		slot.changedGeneration = generation;
+		if (slot.changeIndex == CLEAN) {
+			slot.changeIndex = (int)changes.size();
+			changes.push_back(transforms::Change{ id, slot.transform });
+		}
+		else {
+			changes[slot.changeIndex].transform = slot.transform;
+		}
+	}
+
+
+	void detach(Slot& slot)
+	{
+		slots[slot.parent].childCount--;
+		slot.parent = transforms::NO_TRANSFORM;
+		isHierarchyChanged = true;
+	}
+
+
+	int getDepth(transforms::TransformId id)
+	{
+		int depth = 0;
+		for (transforms::TransformId parent = slots[id].parent; parent != transforms::NO_TRANSFORM; parent = slots[parent].parent) {
+			depth++;
+		}
+		return depth;
+	}
+
+
+	//Drops detached and destroyed transforms and duplicates, then orders by depth and id
+	void rebuildHierarchy()
+	{
+		hierarchyEntries.clear();
+		for (transforms::TransformId id : hierarchy) {
+			Slot& slot = slots[id];
+			if (slot.isAlive && slot.parent != transforms::NO_TRANSFORM && !slot.isListed) {
+				slot.isListed = true;
+				hierarchyEntries.push_back(HierarchyEntry{ getDepth(id), id });
+			}
+		}
+		std::sort(hierarchyEntries.begin(), hierarchyEntries.end(), [](HierarchyEntry const& left, HierarchyEntry const& right) {
+			return left.depth != right.depth ? left.depth < right.depth : left.id < right.id;
+		});
+		hierarchy.clear();
+		for (HierarchyEntry const& entry : hierarchyEntries) {
+			slots[entry.id].isListed = false;
+			hierarchy.push_back(entry.id);
+		}
+		isHierarchyChanged = false;
+	}
+}
+
+
+namespace transforms
+{
+	void reserve(int count)
+	{
+		slots.reserve(count);
+		freeSlots.reserve(count);
+		changes.reserve(count);
+		hierarchy.reserve(count);
+		hierarchyEntries.reserve(count);
+	}
+
+
+	TransformId create(scene::Mesh* mesh)
+	{
+		Slot slot;
+		slot.transform.position = Vector2();
+		slot.transform.angle = 0.f;
+		slot.rotation = Rotation2();
+		slot.rotationAngle = 0.f;
+		slot.local = slot.transform;
+		slot.localRotation = Rotation2();
+		slot.mesh = mesh;
+		slot.changeIndex = CLEAN;
+		slot.parent = NO_TRANSFORM;
+		slot.childCount = 0;
+		slot.changedGeneration = generation;
+		slot.isLocalChanged = false;
+		slot.isListed = false;
+		slot.isAlive = true;
+
+		TransformId id;
+		if (freeSlots.empty()) {
+			id = (TransformId)slots.size();
+			slots.push_back(slot);
+			//As large as slots, so even a deinit freeing every transform only stores ids
+			freeSlots.reserve(slots.capacity());
+		}
+		else {
+			id = freeSlots.back();
+			freeSlots.pop_back();
+			slots[id] = slot;
+		}
+		//A new transform is reported once even if it stays at the origin
+		slots[id].changeIndex = (int)changes.size();
+		changes.push_back(Change{ id, slot.transform });
+		return id;
+	}
+
+
+	void destroy(TransformId id)
+	{
+		Slot& slot = getSlot(id);
+		if (slot.changeIndex != CLEAN) {
+			Change& last = changes.back();
+			slots[last.id].changeIndex = slot.changeIndex;
+			changes[slot.changeIndex] = last;
+			changes.pop_back();
+		}
+		if (slot.parent != NO_TRANSFORM) {
+			detach(slot);
+		}
+		//Children are rare, only carriers with aircraft on deck have them
+		if (slot.childCount > 0) {
+			for (TransformId child : hierarchy) {
+				if (slots[child].isAlive && slots[child].parent == id) {
+					detach(slots[child]);
+				}
+			}
+			assert(slot.childCount == 0);
+		}
+		slot.isAlive = false;
+		slot.mesh = nullptr;
+		freeSlots.push_back(id);
+	}
+
+
+	void set(TransformId id, Vector2 position, float angle)
+	{
+		Slot& slot = getSlot(id);
+		assert(slot.parent == NO_TRANSFORM);
+		setWorld(id, slot, position, angle);
+	}
+
+
+	Transform get(TransformId id)
+	{
+		return getSlot(id).transform;
+	}
+
+
+	void setParent(TransformId id, TransformId parent)
+	{
+		Slot& slot = getSlot(id);
+		if (slot.parent == parent) {
+			return;
+		}
+		if (slot.parent != NO_TRANSFORM) {
+			detach(slot);
+		}
+		if (parent == NO_TRANSFORM) {
+			return;
+		}
+		Slot& parentSlot = getSlot(parent);
+		for (TransformId ancestor = parent; ancestor != NO_TRANSFORM; ancestor = slots[ancestor].parent) {
+			assert(ancestor != id && "transform can't be its own ancestor");
+		}
+		parentSlot.childCount++;
+		slot.parent = parent;
+		Rotation2 toParent = getRotation(parentSlot).inverse();
+		slot.local.position = toParent.rotate(slot.transform.position - parentSlot.transform.position);
+		slot.local.angle = slot.transform.angle - parentSlot.transform.angle;
+		slot.localRotation = rotationFromAngle(slot.local.angle);
+		slot.isLocalChanged = true;
+		hierarchy.push_back(id);
+		isHierarchyChanged = true;
+	}
+
+
+	void setLocal(TransformId id, Vector2 position, float angle)
+	{
+		Slot& slot = getSlot(id);
+		if (slot.parent == NO_TRANSFORM) {
+			setWorld(id, slot, position, angle);
+			return;
+		}
+		if (slot.local.position.x == position.x && slot.local.position.y == position.y && slot.local.angle == angle) {
+			return;
+		}
+		if (slot.local.angle != angle) {
+			slot.localRotation = rotationFromAngle(angle);
+		}
+		slot.local.position = position;
+		slot.local.angle = angle;
+		slot.isLocalChanged = true;
+	}
+
+
+	void resolve()
+	{
+		if (isHierarchyChanged) {
+			rebuildHierarchy();
+		}
+		for (TransformId id : hierarchy) {
+			Slot& slot = slots[id];
+			Slot& parent = slots[slot.parent];
+			if (!slot.isLocalChanged && parent.changedGeneration != generation) {
+				continue;
+			}
+			slot.isLocalChanged = false;
+			Transform2 parentTransform(parent.transform.position, getRotation(parent));
+			Transform2 world = parentTransform * Transform2(slot.local.position, slot.localRotation);
+			setWorld(id, slot, world.position, parent.transform.angle + slot.local.angle);
+			//Grandchildren compose with the resolved rotation, parents come first in the hierarchy
+			slot.rotation = world.rotation;
+			slot.rotationAngle = slot.transform.angle;
+		}
+		generation++;
+	}
+
+
+	std::vector<Change> const& getChanges()
+	{
+		return changes;
+	}
+
+
+	void endFrame()
+	{
+		resolve();
+		for (Change const& change : changes) {
+			Slot& slot = slots[change.id];
+			if (slot.mesh) {
+				scene::placeMesh(slot.mesh, change.transform.position.x, change.transform.position.y, change.transform.angle);
+			}
+			slot.changeIndex = CLEAN;
+		}
+		changes.clear();
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "../framework/scene.hpp"
+#include "supporting_function.h"
+
+#include <vector>
+
+//-------------------------------------------------------
+//	Poses of all placed entities with dirty tracking.
+//	Entities may write their pose every frame, only a pose
+//	that really differs gets into the change list of the
+//	frame, so consumers (mesh placement, replay, network)
+//	touch moving entities only and an idle fleet costs nothing.
+//	A transform may follow a parent, its world pose is then
+//	resolved from the local one in a single pass per frame,
+//	parents first, skipping children of unmoved parents.
+//-------------------------------------------------------
+
+namespace transforms
+{
+	typedef int TransformId;
+	constexpr TransformId NO_TRANSFORM = -1;
+
+	struct Transform
+	{
+		Vector2 position;
+		float angle;
+	};
+
+	struct Change
+	{
+		TransformId id;
+		//Latest pose written this frame
+		Transform transform;
+	};
+
+	//Slots, change list and hierarchy sized for count transforms
+	void reserve(int count);
+	//Mesh is placed on every change, it may be null
+	TransformId create(scene::Mesh* mesh);
+	//Drops a pending change too, so a change list never refers to a destroyed transform.
+	//Children of the transform are detached and stay where they are
+	void destroy(TransformId id);
+	//World pose of a transform without a parent
+	void set(TransformId id, Vector2 position, float angle);
+	//World pose as of the last resolve for children
+	Transform get(TransformId id);
+
+	//The world pose is kept until the next setLocal, NO_TRANSFORM detaches
+	void setParent(TransformId id, TransformId parent);
+	//Pose in the parent space, for a transform without a parent the same as set
+	void setLocal(TransformId id, Vector2 position, float angle);
+	//World poses of children whose local pose or parent changed since the last resolve.
+	//endFrame resolves too, this is for reading children in the middle of a frame
+	void resolve();
+
+	//Transforms changed since the last endFrame, each one at most once, children once resolved
+	std::vector<Change> const& getChanges();
+	//Resolves, places meshes of changed transforms and starts an empty change list
+	void endFrame();
+}
@@ -0,0 +1,615 @@
+#include "world.h"
+#include "world_format.h"
+#include "../framework/allocation_tracker.hpp"
+#include "../framework/mapped_file.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace
+{
+	using namespace world::format;
+
+	struct ChunkCoord
+	{
+		int32_t x;
+		int32_t y;
+	};
+
+	//Decoded chunk, positions relative to its lower left corner
+	struct Chunk
+	{
+		Vector2 current;
+		std::vector<world::Island> islands;
+		std::vector<world::SpawnPoint> spawnPoints;
+		DistanceField obstacles;
+	};
+
+	MappedFile file;
+	float chunkSize = 1.f;
+	ChunkCoord firstChunk = { 0, 0 };
+	ChunkCoord chunkCount = { 0, 0 };
+	//Chunk whose lower left corner is at local zero
+	ChunkCoord origin = { 0, 0 };
+
+	struct LoadedChunk
+	{
+		uint64_t key;
+		Chunk chunk;
+	};
+
+	//Simulation thread only. These are short vectors that keep their capacity,
+	//so streaming doesn't allocate once every carrier has sailed a bit
+	std::vector<LoadedChunk> loadedChunks;
+	//Sorted keys
+	std::vector<uint64_t> requestedChunks;
+	std::vector<uint64_t> wantedChunks;
+	std::vector<ChunkCoord> newRequests;
+	DistanceBatch obstacleBatch;
+
+	//Shared with the loader thread
+	std::mutex loaderMutex;
+	std::condition_variable loaderWakeUp;
+	std::condition_variable resultsReady;
+	std::vector<ChunkCoord> requests;
+	std::vector<std::pair<ChunkCoord, Chunk>> results;
+	bool isLoaderStopping = false;
+	std::thread loader;
+
+
+	uint64_t getKey(ChunkCoord coord)
+	{
+		return (uint64_t)(uint32_t)coord.x << 32 | (uint32_t)coord.y;
+	}
+
+
+	Chunk* findLoadedChunk(uint64_t key)
+	{
+		for (LoadedChunk& loaded : loadedChunks) {
+			if (loaded.key == key) {
+				return &loaded.chunk;
+			}
+		}
+		return nullptr;
+	}
+
+
+	bool isWanted(uint64_t key)
+	{
+		return std::binary_search(wantedChunks.begin(), wantedChunks.end(), key);
+	}
+
+
+	bool isInside(ChunkCoord coord)
+	{
+		return coord.x >= firstChunk.x && coord.x - firstChunk.x < chunkCount.x &&
+			coord.y >= firstChunk.y && coord.y - firstChunk.y < chunkCount.y;
+	}
+
+
+	ChunkCoord getChunkCoord(Vector2 position)
+	{
+		return ChunkCoord{ origin.x + (int32_t)std::floor(position.x / chunkSize), origin.y + (int32_t)std::floor(position.y / chunkSize) };
+	}
+
+
+	//Local position of the chunk lower left corner, exact while the chunk is near the origin
+	Vector2 getChunkCorner(ChunkCoord coord)
+	{
+		return Vector2((float)(coord.x - origin.x) * chunkSize, (float)(coord.y - origin.y) * chunkSize);
+	}
+
+
+	float readF32(uint8_t const* data)
+	{
+		float value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+
+	uint32_t readU32(uint8_t const* data)
+	{
+		return data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+	}
+
+
+	uint64_t readU64(uint8_t const* data)
+	{
+		return readU32(data) | (uint64_t)readU32(data + 4) << 32;
+	}
+
+
+	bool getChunkRange(ChunkCoord coord, uint64_t* offset, uint32_t* size)
+	{
+		size_t index = (size_t)(coord.y - firstChunk.y) * chunkCount.x + (coord.x - firstChunk.x);
+		uint8_t const* entry = file.getData() + HEADER_SIZE + index * DIRECTORY_ENTRY_SIZE;
+		*offset = readU64(entry);
+		*size = readU32(entry + 8);
+		return *offset <= file.getSize() && *size <= file.getSize() - *offset;
+	}
+
+
+	//Touches the mapped pages, so it runs on the loader thread except at level start
+	bool decodeChunk(ChunkCoord coord, Chunk& chunk)
+	{
+		chunk.current = Vector2();
+		chunk.islands.clear();
+		chunk.spawnPoints.clear();
+
+		uint64_t offset;
+		uint32_t size;
+		if (!getChunkRange(coord, &offset, &size)) {
+			return false;
+		}
+		if (size == 0) {
+			return true;
+		}
+
+		uint8_t const* data = file.getData() + offset;
+		uint8_t const* end = data + size;
+		if (end - data < 12) {
+			return false;
+		}
+		chunk.current = Vector2(readF32(data), readF32(data + 4));
+		uint32_t islandCount = readU32(data + 8);
+		data += 12;
+		if ((uint64_t)(end - data) < (uint64_t)islandCount * ISLAND_SIZE + 4) {
+			return false;
+		}
+		for (uint32_t index = 0; index < islandCount; index++, data += ISLAND_SIZE) {
+			chunk.islands.push_back(world::Island{ Vector2(readF32(data), readF32(data + 4)), readF32(data + 8) });
+		}
+		uint32_t spawnCount = readU32(data);
+		data += 4;
+		if ((uint64_t)(end - data) < (uint64_t)spawnCount * SPAWN_SIZE) {
+			return false;
+		}
+		for (uint32_t index = 0; index < spawnCount; index++, data += SPAWN_SIZE) {
+			chunk.spawnPoints.push_back(world::SpawnPoint{ Vector2(readF32(data), readF32(data + 4)), readF32(data + 8) });
+		}
+		return true;
+	}
+
+
+	//Shores of the neighbour chunks reach into this one, so their islands are decoded too
+	void bakeObstacles(ChunkCoord coord, Chunk& chunk)
+	{
+		std::vector<ObstacleCircle> circles;
+		Chunk neighbour;
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				ChunkCoord nearCoord = { coord.x + dx, coord.y + dy };
+				Chunk const* source = &chunk;
+				if (dx != 0 || dy != 0) {
+					if (!isInside(nearCoord) || !decodeChunk(nearCoord, neighbour)) {
+						continue;
+					}
+					source = &neighbour;
+				}
+				Vector2 offset((float)dx * chunkSize, (float)dy * chunkSize);
+				for (world::Island const& island : source->islands) {
+					circles.push_back(ObstacleCircle{ island.center + offset, island.radius });
+				}
+			}
+		}
+		chunk.obstacles.bake(circles, chunkSize);
+	}
+
+
+	void decodeOrWarn(ChunkCoord coord, Chunk& chunk)
+	{
+		if (!decodeChunk(coord, chunk)) {
+			std::fprintf(stderr, "world: chunk %d %d is corrupted, using open ocean\n", coord.x, coord.y);
+			chunk = Chunk();
+			return;
+		}
+		bakeObstacles(coord, chunk);
+	}
+
+
+	void runLoader()
+	{
+		allocations::Scope allocationScope(allocations::SUBSYSTEM_BACKGROUND);
+		std::vector<ChunkCoord> batch;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(loaderMutex);
+				loaderWakeUp.wait(lock, [] { return isLoaderStopping || !requests.empty(); });
+				if (isLoaderStopping) {
+					return;
+				}
+				//Copied rather than swapped, so the request list keeps its capacity
+				//and the simulation thread doesn't allocate when it posts requests
+				batch.assign(requests.begin(), requests.end());
+				requests.clear();
+			}
+			for (ChunkCoord coord : batch) {
+				Chunk chunk;
+				decodeOrWarn(coord, chunk);
+				{
+					std::lock_guard<std::mutex> lock(loaderMutex);
+					results.emplace_back(coord, std::move(chunk));
+				}
+				resultsReady.notify_one();
+			}
+			batch.clear();
+		}
+	}
+
+
+	void releaseChunk(ChunkCoord coord)
+	{
+		uint64_t offset;
+		uint32_t size;
+		if (getChunkRange(coord, &offset, &size)) {
+			file.release((size_t)offset, size);
+		}
+	}
+
+
+	//Moves finished chunks to the loaded ones, the loader mutex must be held
+	void takeResults()
+	{
+		for (auto& result : results) {
+			uint64_t key = getKey(result.first);
+			auto requested = std::lower_bound(requestedChunks.begin(), requestedChunks.end(), key);
+			if (requested != requestedChunks.end() && *requested == key) {
+				requestedChunks.erase(requested);
+			}
+			//Carriers may have left while the chunk was loading, and a chunk
+			//loaded meanwhile at level start holds the same data
+			if (!isWanted(key) || findLoadedChunk(key)) {
+				continue;
+			}
+			loadedChunks.push_back(LoadedChunk{ key, std::move(result.second) });
+		}
+		results.clear();
+	}
+
+
+	//Queries read chunks only through here. A chunk still loading is waited for rather than
+	//taken for open ocean, so what the simulation sees doesn't depend on how far the loader got
+	Chunk const* getChunk(ChunkCoord coord)
+	{
+		if (!isInside(coord)) {
+			return nullptr;
+		}
+		uint64_t key = getKey(coord);
+		Chunk const* chunk = findLoadedChunk(key);
+		if (chunk) {
+			return chunk;
+		}
+
+		//Wanted until the next update, which drops it again if nothing is around
+		auto wanted = std::lower_bound(wantedChunks.begin(), wantedChunks.end(), key);
+		if (wanted == wantedChunks.end() || *wanted != key) {
+			wantedChunks.insert(wanted, key);
+		}
+		std::unique_lock<std::mutex> lock(loaderMutex);
+		auto requested = std::lower_bound(requestedChunks.begin(), requestedChunks.end(), key);
+		if (requested == requestedChunks.end() || *requested != key) {
+			requestedChunks.insert(requested, key);
+			//Ahead of the chunks only loaded in advance
+			requests.insert(requests.begin(), coord);
+			loaderWakeUp.notify_one();
+		}
+		while (true) {
+			takeResults();
+			chunk = findLoadedChunk(key);
+			if (chunk) {
+				return chunk;
+			}
+			resultsReady.wait(lock, [] { return !results.empty(); });
+		}
+	}
+
+
+	//Calls visit for every chunk overlapping the square around center, row by row
+	template <class Visitor>
+	void visitChunks(Vector2 center, float radius, Visitor visit)
+	{
+		ChunkCoord first = getChunkCoord(Vector2(center.x - radius, center.y - radius));
+		ChunkCoord last = getChunkCoord(Vector2(center.x + radius, center.y + radius));
+		for (ChunkCoord coord = first; coord.y <= last.y; coord.y++) {
+			for (coord.x = first.x; coord.x <= last.x; coord.x++) {
+				Chunk const* chunk = getChunk(coord);
+				if (chunk) {
+					visit(getChunkCorner(coord), *chunk);
+				}
+			}
+		}
+	}
+}
+
+
+namespace world
+{
+	bool open(char const* path)
+	{
+		close();
+		if (!file.open(path)) {
+			return false;
+		}
+
+		uint8_t const* header = file.getData();
+		bool isValid = file.getSize() >= HEADER_SIZE && std::memcmp(header, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 && readU32(header + 8) == VERSION;
+		if (isValid) {
+			chunkSize = readF32(header + 12);
+			firstChunk = ChunkCoord{ (int32_t)readU32(header + 16), (int32_t)readU32(header + 20) };
+			chunkCount = ChunkCoord{ (int32_t)readU32(header + 24), (int32_t)readU32(header + 28) };
+			uint64_t directorySize = (uint64_t)(uint32_t)chunkCount.x * (uint32_t)chunkCount.y * DIRECTORY_ENTRY_SIZE;
+			//Distance fields only look one chunk around
+			isValid = chunkSize >= params::world::OBSTACLE_RANGE && chunkCount.x >= 0 && chunkCount.y >= 0 && directorySize <= file.getSize() - HEADER_SIZE;
+		}
+		if (!isValid) {
+			std::fprintf(stderr, "world: %s is not a world file\n", path);
+			file.close();
+			return false;
+		}
+
+		origin = ChunkCoord{ 0, 0 };
+		isLoaderStopping = false;
+		loader = std::thread(runLoader);
+		return true;
+	}
+
+
+	void close()
+	{
+		if (!file.isOpen()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(loaderMutex);
+			isLoaderStopping = true;
+			requests.clear();
+		}
+		loaderWakeUp.notify_one();
+		loader.join();
+		results.clear();
+		loadedChunks.clear();
+		requestedChunks.clear();
+		file.close();
+	}
+
+
+	bool isOpen()
+	{
+		return file.isOpen();
+	}
+
+
+	void update(std::vector<Vector2> const& positions)
+	{
+		if (!file.isOpen()) {
+			return;
+		}
+
+		//Sized for as many positions as the caller has room for, arrivals may briefly
+		//double the loaded chunks until the ones left behind are dropped
+		int side = 2 * params::world::ACTIVE_RADIUS_CHUNKS + 1;
+		size_t maximalWanted = positions.capacity() * side * side;
+		wantedChunks.reserve(maximalWanted);
+		requestedChunks.reserve(maximalWanted);
+		newRequests.reserve(maximalWanted);
+		loadedChunks.reserve(2 * maximalWanted);
+
+		wantedChunks.clear();
+		for (Vector2 position : positions) {
+			ChunkCoord center = getChunkCoord(position);
+			for (int dy = -params::world::ACTIVE_RADIUS_CHUNKS; dy <= params::world::ACTIVE_RADIUS_CHUNKS; dy++) {
+				for (int dx = -params::world::ACTIVE_RADIUS_CHUNKS; dx <= params::world::ACTIVE_RADIUS_CHUNKS; dx++) {
+					ChunkCoord coord = { center.x + dx, center.y + dy };
+					if (isInside(coord)) {
+						wantedChunks.push_back(getKey(coord));
+					}
+				}
+			}
+		}
+
+		std::sort(wantedChunks.begin(), wantedChunks.end());
+		wantedChunks.erase(std::unique(wantedChunks.begin(), wantedChunks.end()), wantedChunks.end());
+
+		{
+			std::lock_guard<std::mutex> lock(loaderMutex);
+			takeResults();
+		}
+
+		for (size_t index = 0; index < loadedChunks.size();) {
+			uint64_t key = loadedChunks[index].key;
+			if (isWanted(key)) {
+				index++;
+				continue;
+			}
+			releaseChunk(ChunkCoord{ (int32_t)(key >> 32), (int32_t)(uint32_t)key });
+			loadedChunks[index] = std::move(loadedChunks.back());
+			loadedChunks.pop_back();
+		}
+
+		newRequests.clear();
+		for (uint64_t key : wantedChunks) {
+			if (findLoadedChunk(key)) {
+				continue;
+			}
+			auto requested = std::lower_bound(requestedChunks.begin(), requestedChunks.end(), key);
+			if (requested == requestedChunks.end() || *requested != key) {
+				requestedChunks.insert(requested, key);
+				newRequests.push_back(ChunkCoord{ (int32_t)(key >> 32), (int32_t)(uint32_t)key });
+			}
+		}
+		if (!newRequests.empty()) {
+			{
+				std::lock_guard<std::mutex> lock(loaderMutex);
+				requests.reserve(maximalWanted);
+				requests.insert(requests.end(), newRequests.begin(), newRequests.end());
+			}
+			loaderWakeUp.notify_one();
+		}
+	}
+
+
+	void loadAround(Vector2 position)
+	{
+		if (!file.isOpen()) {
+			return;
+		}
+		//Chunks are decoded and baked in parallel, the first frame waits for all of them
+		ChunkCoord center = getChunkCoord(position);
+		std::vector<ChunkCoord> missing;
+		for (int dy = -params::world::ACTIVE_RADIUS_CHUNKS; dy <= params::world::ACTIVE_RADIUS_CHUNKS; dy++) {
+			for (int dx = -params::world::ACTIVE_RADIUS_CHUNKS; dx <= params::world::ACTIVE_RADIUS_CHUNKS; dx++) {
+				ChunkCoord coord = { center.x + dx, center.y + dy };
+				if (isInside(coord) && !findLoadedChunk(getKey(coord))) {
+					missing.push_back(coord);
+				}
+			}
+		}
+		//Slots are added before the tasks start, so none of them moves while decoded into
+		size_t firstSlot = loadedChunks.size();
+		for (ChunkCoord coord : missing) {
+			loadedChunks.push_back(LoadedChunk{ getKey(coord), Chunk() });
+		}
+		std::vector<std::future<void>> tasks;
+		for (size_t index = 0; index < missing.size(); index++) {
+			ChunkCoord coord = missing[index];
+			Chunk* chunk = &loadedChunks[firstSlot + index].chunk;
+			tasks.push_back(std::async(std::launch::async, [coord, chunk] { decodeOrWarn(coord, *chunk); }));
+		}
+		for (auto& task : tasks) {
+			task.get();
+		}
+	}
+
+
+	Vector2 rebase(Vector2 focus)
+	{
+		float limit = params::world::REBASE_DISTANCE_CHUNKS * chunkSize;
+		if (!file.isOpen() || (std::abs(focus.x) <= limit && std::abs(focus.y) <= limit)) {
+			return Vector2();
+		}
+		int32_t shiftX = (int32_t)std::floor(focus.x / chunkSize + 0.5f);
+		int32_t shiftY = (int32_t)std::floor(focus.y / chunkSize + 0.5f);
+		origin.x += shiftX;
+		origin.y += shiftY;
+		return Vector2((float)shiftX * chunkSize, (float)shiftY * chunkSize);
+	}
+
+
+	Vector2 getSeaCurrent(Vector2 position)
+	{
+		if (!file.isOpen()) {
+			return Vector2();
+		}
+		Chunk const* chunk = getChunk(getChunkCoord(position));
+		return chunk ? chunk->current : Vector2();
+	}
+
+
+	void queryIslands(Vector2 center, float radius, std::vector<Island>& islands)
+	{
+		if (!file.isOpen()) {
+			return;
+		}
+		visitChunks(center, radius, [&](Vector2 corner, Chunk const& chunk) {
+			for (Island const& island : chunk.islands) {
+				Vector2 islandCenter = corner + island.center;
+				float reach = radius + island.radius;
+				if ((islandCenter - center).lengthSquare() <= reach * reach) {
+					islands.push_back(Island{ islandCenter, island.radius });
+				}
+			}
+		});
+	}
+
+
+	void querySpawnPoints(Vector2 center, float radius, std::vector<SpawnPoint>& spawnPoints)
+	{
+		if (!file.isOpen()) {
+			return;
+		}
+		visitChunks(center, radius, [&](Vector2 corner, Chunk const& chunk) {
+			for (SpawnPoint const& spawnPoint : chunk.spawnPoints) {
+				Vector2 position = corner + spawnPoint.position;
+				if ((position - center).lengthSquare() <= radius * radius) {
+					spawnPoints.push_back(SpawnPoint{ position, spawnPoint.angle });
+				}
+			}
+		});
+	}
+
+
+	void sampleObstacles(std::vector<Vector2> const& positions, std::vector<ObstacleSample>& samples)
+	{
+		samples.resize(positions.size());
+		if (!file.isOpen()) {
+			std::fill(samples.begin(), samples.end(), getOpenWaterSample());
+			return;
+		}
+
+		//Every chunk is in place before the batch keeps pointers to their fields,
+		//waiting for one may move the others
+		uint64_t lastKey = 0;
+		bool isLastFound = false;
+		for (Vector2 position : positions) {
+			ChunkCoord coord = getChunkCoord(position);
+			uint64_t key = getKey(coord);
+			if (!isLastFound || key != lastKey) {
+				lastKey = key;
+				getChunk(coord);
+				isLastFound = true;
+			}
+		}
+
+		//Fleets are close together, so the last chunk found is usually the next one too
+		obstacleBatch.clear();
+		//Callers reserve for their largest fleet, the batch follows
+		obstacleBatch.reserve((int)positions.capacity());
+		Chunk const* lastChunk = nullptr;
+		Vector2 lastCorner;
+		isLastFound = false;
+		for (Vector2 position : positions) {
+			ChunkCoord coord = getChunkCoord(position);
+			uint64_t key = getKey(coord);
+			if (!isLastFound || key != lastKey) {
+				lastKey = key;
+				lastChunk = findLoadedChunk(key);
+				lastCorner = getChunkCorner(coord);
+				isLastFound = true;
+			}
+			obstacleBatch.add(lastChunk && !lastChunk->obstacles.isEmpty() ? &lastChunk->obstacles : nullptr, position - lastCorner);
+		}
+		obstacleBatch.interpolate(samples.data());
+	}
+
+
+	int getLoadedChunkCount()
+	{
+		return (int)loadedChunks.size();
+	}
+
+
+	void getOrigin(int32_t* chunkX, int32_t* chunkY, float* size)
+	{
+		*chunkX = origin.x;
+		*chunkY = origin.y;
+		*size = file.isOpen() ? chunkSize : 0.f;
+	}
+
+
+	void setOrigin(int32_t chunkX, int32_t chunkY)
+	{
+		if (!file.isOpen()) {
+			return;
+		}
+		origin = ChunkCoord{ chunkX, chunkY };
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "distance_field.h"
+#include "supporting_function.h"
+
+#include <vector>
+
+//-------------------------------------------------------
+//	Large world streamed from a memory-mapped file.
+//	Chunks around carriers and their aircraft are decoded
+//	ahead on a loader thread, so memory follows the active
+//	regions, not the world size. A query reaching a chunk
+//	still on its way waits for it, the simulation sees the
+//	same world however far the loader got.
+//	All positions here are relative to a floating origin
+//	that moves by whole chunks to keep float coordinates
+//	around the player precise.
+//-------------------------------------------------------
+
+namespace world
+{
+	struct Island
+	{
+		Vector2 center;
+		float radius;
+	};
+
+	struct SpawnPoint
+	{
+		Vector2 position;
+		float angle;
+	};
+
+	//Without a world file the sea is empty and endless and the origin never moves
+	bool open(char const* path);
+	void close();
+	bool isOpen();
+
+	//Requests chunks around carriers and airborne aircraft and drops the rest, never waits for the loader
+	void update(std::vector<Vector2> const& positions);
+	//Loads chunks around position on the calling thread, used before the first frame
+	void loadAround(Vector2 position);
+
+	//Moves the origin next to focus when it gets too far. Returns the offset
+	//that must be subtracted from every position, zero if the origin stays
+	Vector2 rebase(Vector2 focus);
+
+	//Zero in open ocean
+	Vector2 getSeaCurrent(Vector2 position);
+	//Append islands and spawn points within radius of center, in a stable order
+	void queryIslands(Vector2 center, float radius, std::vector<Island>& islands);
+	void querySpawnPoints(Vector2 center, float radius, std::vector<SpawnPoint>& spawnPoints);
+	//One bilinear lookup per position into the distance fields baked with the chunks
+	void sampleObstacles(std::vector<Vector2> const& positions, std::vector<ObstacleSample>& samples);
+
+	int getLoadedChunkCount();
+	//World file chunk whose lower left corner is at local zero, chunk size is zero without a world file
+	void getOrigin(int32_t* chunkX, int32_t* chunkY, float* chunkSize);
+	//Puts the origin back where a checkpoint was taken, positions saved with it stay valid.
+	//Chunks around the restored carriers are loaded with loadAround afterwards
+	void setOrigin(int32_t chunkX, int32_t chunkY);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+
+//-------------------------------------------------------
+//	World file layout, all values little-endian.
+//
+//	header:		char magic[8], u32 version, f32 chunkSize,
+//				i32 firstChunkX, i32 firstChunkY, u32 chunkCountX, u32 chunkCountY
+//	directory:	chunkCountY * chunkCountX * { u64 offset, u32 size }, rows of increasing y
+//	chunk:		f32 currentX, f32 currentY,
+//				u32 islandCount, islandCount * { f32 x, f32 y, f32 radius },
+//				u32 spawnCount, spawnCount * { f32 x, f32 y, f32 angle }
+//
+//	Chunk (x, y) covers [x * chunkSize; (x + 1) * chunkSize) along each axis,
+//	island and spawn positions are relative to its lower left corner.
+//	Islands lie entirely inside their chunk.
+//	A chunk of zero size is open ocean without current.
+//-------------------------------------------------------
+
+namespace world
+{
+	namespace format
+	{
+		constexpr char FILE_MAGIC[8] = { 'W', 'O', 'T', 'S', 'W', 'L', 'D', '1' };
+		constexpr uint32_t VERSION = 1;
+
+		constexpr uint32_t HEADER_SIZE = 8 + 4 * 6;
+		constexpr uint32_t DIRECTORY_ENTRY_SIZE = 8 + 4;
+		constexpr uint32_t ISLAND_SIZE = 4 * 3;
+		constexpr uint32_t SPAWN_SIZE = 4 * 3;
+	}
+}
@@ -0,0 +1,121 @@
+#include "world_view.h"
+#include "../framework/shared_memory.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+namespace
+{
+	using namespace world_view::format;
+
+	SharedMemory region;
+	RegionHeader* header = nullptr;
+	uint32_t frame = 0;
+
+	//Slot being written between beginFrame and endFrame
+	uint32_t writeSlot = 0;
+	SlotHeader* slot = nullptr;
+	ShipRecord* ships = nullptr;
+	AircraftRecord* aircraft = nullptr;
+
+
+	uint8_t* getSlotData(uint32_t index)
+	{
+		return region.getData() + getSlotOffset(index, header->slotSize);
+	}
+}
+
+
+namespace world_view
+{
+	bool start(char const* name, uint32_t shipCapacity, uint32_t aircraftCapacity)
+	{
+		assert(!header);
+		if (!region.create(name, getRegionSize(shipCapacity, aircraftCapacity))) {
+			std::fprintf(stderr, "world view: can't create shared memory %s\n", name);
+			return false;
+		}
+		header = new (region.getData()) RegionHeader();
+		header->version = VERSION;
+		header->shipCapacity = shipCapacity;
+		header->aircraftCapacity = aircraftCapacity;
+		header->slotSize = (uint32_t)getSlotSize(shipCapacity, aircraftCapacity);
+		for (uint32_t index = 0; index < SLOT_COUNT; index++) {
+			new (getSlotData(index)) SlotHeader();
+		}
+		header->latestSlot.store(0, std::memory_order_relaxed);
+		std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+		header->isPublishing.store(1, std::memory_order_release);
+		frame = 0;
+		return true;
+	}
+
+
+	void stop()
+	{
+		if (!header) {
+			return;
+		}
+		header->isPublishing.store(0, std::memory_order_release);
+		header = nullptr;
+		slot = nullptr;
+		region.close();
+	}
+
+
+	bool isRunning()
+	{
+		return header != nullptr;
+	}
+
+
+	void beginFrame(float time, int32_t originChunkX, int32_t originChunkY, float chunkSize)
+	{
+		assert(header && !slot);
+		writeSlot = (header->latestSlot.load(std::memory_order_relaxed) + 1) % SLOT_COUNT;
+		uint8_t* data = getSlotData(writeSlot);
+		slot = reinterpret_cast<SlotHeader*>(data);
+		ships = reinterpret_cast<ShipRecord*>(data + getShipsOffset());
+		aircraft = reinterpret_cast<AircraftRecord*>(data + getAircraftOffset(header->shipCapacity));
+
+		//Odd sequence tells readers still inside this slot that it is being overwritten
+		slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot->frame = frame++;
+		slot->time = time;
+		slot->originChunkX = originChunkX;
+		slot->originChunkY = originChunkY;
+		slot->chunkSize = chunkSize;
+		slot->shipCount = 0;
+		slot->aircraftCount = 0;
+	}
+
+
+	void addShip(format::ShipRecord const& ship)
+	{
+		assert(slot);
+		if (slot->shipCount < header->shipCapacity) {
+			ships[slot->shipCount++] = ship;
+		}
+	}
+
+
+	void addAircraft(format::AircraftRecord const& record)
+	{
+		assert(slot);
+		if (slot->aircraftCount < header->aircraftCapacity) {
+			aircraft[slot->aircraftCount++] = record;
+		}
+	}
+
+
+	void endFrame()
+	{
+		assert(slot);
+		slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		header->latestSlot.store(writeSlot, std::memory_order_release);
+		slot = nullptr;
+	}
+}
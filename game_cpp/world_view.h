@@ -0,0 +1,24 @@
+#pragma once
+#include "world_view_format.h"
+
+//-------------------------------------------------------
+//	Live fleet state published to shared memory for local
+//	observer processes, see world_view_format.h for the
+//	protocol. Frames are written straight into the shared
+//	region, publishing never allocates and never waits for
+//	readers. world_view_reader.h is the reading side.
+//-------------------------------------------------------
+
+namespace world_view
+{
+	bool start(char const* name, uint32_t shipCapacity, uint32_t aircraftCapacity);
+	void stop();
+	bool isRunning();
+
+	void beginFrame(float time, int32_t originChunkX, int32_t originChunkY, float chunkSize);
+	//Records beyond the capacity given to start are dropped
+	void addShip(format::ShipRecord const& ship);
+	void addAircraft(format::AircraftRecord const& aircraft);
+	//Readers see the frame from here on
+	void endFrame();
+}
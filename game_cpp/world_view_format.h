@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//-------------------------------------------------------
+//	Live world view layout in shared memory, native byte order
+//	since readers run on the same machine.
+//
+//	region:	RegionHeader, SLOT_COUNT * slot, every part 64 byte aligned
+//	slot:	SlotHeader, shipCapacity * ShipRecord, aircraftCapacity * AircraftRecord
+//
+//	The game writes the slot readers were not sent to last and then points
+//	latestSlot at it. Each slot is guarded by a sequence counter, odd while
+//	the slot is written: a reader remembers the even value it started with
+//	and the frame it read is consistent when the counter still has it after.
+//	Readers read the slot in place and the writer never waits for them, a
+//	reader only retries when it spent longer than a whole frame in a slot.
+//-------------------------------------------------------
+
+namespace world_view
+{
+	namespace format
+	{
+		constexpr char MAGIC[8] = { 'W', 'O', 'T', 'S', 'V', 'I', 'E', 'W' };
+		constexpr uint32_t VERSION = 1;
+		constexpr uint32_t SLOT_COUNT = 2;
+		constexpr size_t ALIGNMENT = 64;
+
+		static_assert(ATOMIC_INT_LOCK_FREE == 2, "sequence counters are shared between processes, they must not hide a lock");
+
+		struct RegionHeader
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t shipCapacity;
+			uint32_t aircraftCapacity;
+			uint32_t slotSize;
+			//Slot with the newest complete frame
+			std::atomic<uint32_t> latestSlot;
+			//Cleared when the game stops, the region may be recreated under the same name later
+			std::atomic<uint32_t> isPublishing;
+		};
+
+		struct SlotHeader
+		{
+			std::atomic<uint32_t> sequence;
+			uint32_t frame;
+			float time;
+			//Positions are relative to the floating origin, the lower left corner of this world file chunk
+			int32_t originChunkX;
+			int32_t originChunkY;
+			//Zero in the endless open ocean, the origin never moves there
+			float chunkSize;
+			uint32_t shipCount;
+			uint32_t aircraftCount;
+		};
+
+		struct ShipRecord
+		{
+			float x;
+			float y;
+			float angle;
+			//The first ship is the player one
+			uint32_t isPlayer;
+		};
+
+		//Every aircraft of every ship, the ones in a hangar keep their last flight position
+		struct AircraftRecord
+		{
+			float x;
+			float y;
+			float angle;
+			float speed;
+			float flightTime;
+			//AircraftStatus value
+			uint32_t status;
+			uint32_t shipIndex;
+		};
+
+		constexpr size_t alignSize(size_t size) {
+			return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+		}
+
+		constexpr size_t getShipsOffset() {
+			return alignSize(sizeof(SlotHeader));
+		}
+
+		constexpr size_t getAircraftOffset(uint32_t shipCapacity) {
+			return getShipsOffset() + alignSize(shipCapacity * sizeof(ShipRecord));
+		}
+
+		constexpr size_t getSlotSize(uint32_t shipCapacity, uint32_t aircraftCapacity) {
+			return getAircraftOffset(shipCapacity) + alignSize(aircraftCapacity * sizeof(AircraftRecord));
+		}
+
+		constexpr size_t getSlotOffset(uint32_t slot, size_t slotSize) {
+			return alignSize(sizeof(RegionHeader)) + slot * slotSize;
+		}
+
+		constexpr size_t getRegionSize(uint32_t shipCapacity, uint32_t aircraftCapacity) {
+			return getSlotOffset(SLOT_COUNT, getSlotSize(shipCapacity, aircraftCapacity));
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#include "world_view_reader.h"
+
+#include <cstring>
+
+namespace
+{
+	using namespace world_view::format;
+
+	//The writer only reuses a slot every other frame, so a retry almost always succeeds
+	constexpr int MAX_ACQUIRE_ATTEMPTS = 4;
+}
+
+
+WorldViewReader::WorldViewReader() :
+	_header(nullptr)
+{
+}
+
+bool WorldViewReader::open(char const* name) {
+	close();
+	if (!_region.open(name)) {
+		return false;
+	}
+	RegionHeader const* header = reinterpret_cast<RegionHeader const*>(_region.getData());
+	bool isValid = _region.getSize() >= sizeof(RegionHeader) && header->isPublishing.load(std::memory_order_acquire) &&
+		std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION;
+	if (!isValid || _region.getSize() < getRegionSize(header->shipCapacity, header->aircraftCapacity) ||
+		header->slotSize != getSlotSize(header->shipCapacity, header->aircraftCapacity)) {
+		_region.close();
+		return false;
+	}
+	_header = header;
+	return true;
+}
+
+void WorldViewReader::close() {
+	_header = nullptr;
+	_region.close();
+}
+
+bool WorldViewReader::isOpen() {
+	return _header != nullptr;
+}
+
+bool WorldViewReader::acquire(Frame* frame) {
+	if (!_header || !_header->isPublishing.load(std::memory_order_acquire)) {
+		return false;
+	}
+	for (int attempt = 0; attempt < MAX_ACQUIRE_ATTEMPTS; attempt++) {
+		uint32_t slotIndex = _header->latestSlot.load(std::memory_order_acquire) % SLOT_COUNT;
+		uint8_t const* data = _region.getData() + getSlotOffset(slotIndex, _header->slotSize);
+		SlotHeader const* slot = reinterpret_cast<SlotHeader const*>(data);
+		uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+		//Zero is a slot never written, odd one is being written right now
+		if (sequence == 0) {
+			return false;
+		}
+		if (sequence & 1) {
+			continue;
+		}
+		frame->header = slot;
+		frame->ships = reinterpret_cast<ShipRecord const*>(data + getShipsOffset());
+		frame->aircraft = reinterpret_cast<AircraftRecord const*>(data + getAircraftOffset(_header->shipCapacity));
+		//Counts of a torn frame are still bounded, so indexing never leaves the slot
+		frame->shipCount = slot->shipCount < _header->shipCapacity ? slot->shipCount : _header->shipCapacity;
+		frame->aircraftCount = slot->aircraftCount < _header->aircraftCapacity ? slot->aircraftCount : _header->aircraftCapacity;
+		frame->sequence = sequence;
+		return true;
+	}
+	return false;
+}
+
+bool WorldViewReader::isValid(Frame const& frame) {
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return frame.header->sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
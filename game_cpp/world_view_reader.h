@@ -0,0 +1,48 @@
+#pragma once
+#include "world_view_format.h"
+#include "../framework/shared_memory.hpp"
+
+//-------------------------------------------------------
+//	Reading side of the live world view, for tools running
+//	next to the game. Frames are read where the game wrote
+//	them, without copies or system calls:
+//
+//		WorldViewReader::Frame frame;
+//		do {
+//			if (!reader.acquire(&frame)) break;
+//			...read frame.ships and frame.aircraft...
+//		} while (!reader.isValid(frame));
+//-------------------------------------------------------
+
+class WorldViewReader
+{
+public:
+	struct Frame
+	{
+		world_view::format::SlotHeader const* header;
+		world_view::format::ShipRecord const* ships;
+		world_view::format::AircraftRecord const* aircraft;
+		uint32_t shipCount;
+		uint32_t aircraftCount;
+		uint32_t sequence;
+	};
+
+	WorldViewReader();
+
+	//False until the game has started publishing under name
+	bool open(char const* name);
+	void close();
+	bool isOpen();
+
+	//Points frame at the newest complete frame. False when nothing is published
+	//yet or the game keeps overwriting the slot, try again later then.
+	//Also false once the game has stopped, reopen to follow the next run
+	bool acquire(Frame* frame);
+	//Whatever was read from frame since acquire is consistent when this is true,
+	//otherwise it may mix two frames and must be read again
+	bool isValid(Frame const& frame);
+
+private:
+	SharedMemory _region;
+	world_view::format::RegionHeader const* _header;
+};
@@ -0,0 +1,301 @@
+// Bakes the text mesh source (assets/meshes.txt) into the binary mesh file
+// the game maps at startup. Optionally writes the same bytes as a C array
+// that the game falls back to when no mesh file is found next to it.
+
+#include "../framework/mesh_format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace scene::format;
+
+	//Rotation leaves tiny residues instead of exact zeros
+	constexpr float SNAP_TO_ZERO = 1.e-6f;
+	constexpr double PI = 3.14159265358979323846;
+
+	struct Point
+	{
+		float x;
+		float y;
+	};
+
+	struct Mesh
+	{
+		std::string name;
+		float rotation = 0.f;
+		float scale = 1.f;
+		float fill[3] = { 1.f, 1.f, 1.f };
+		float line[3] = { 1.f, 1.f, 1.f };
+		float lineWidth = 1.f;
+		float trailInterval = 0.f;
+		float trailLife = 0.f;
+		float trail[3] = { 1.f, 1.f, 1.f };
+		std::vector<Point> triangles;
+		std::vector<Point> loop;
+	};
+
+
+	void appendU32(std::vector<uint8_t>& bytes, uint32_t value)
+	{
+		for (int shift = 0; shift < 32; shift += 8) {
+			bytes.push_back((uint8_t)(value >> shift));
+		}
+	}
+
+
+	void appendF32(std::vector<uint8_t>& bytes, float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		appendU32(bytes, bits);
+	}
+
+
+	bool readFloats(std::istringstream& line, float* values, int count)
+	{
+		for (int index = 0; index < count; index++) {
+			if (!(line >> values[index])) {
+				return false;
+			}
+		}
+		std::string rest;
+		return !(line >> rest);
+	}
+
+
+	bool parseSource(char const* path, std::vector<Mesh>& meshes)
+	{
+		FILE* file = std::fopen(path, "rb");
+		if (!file) {
+			std::fprintf(stderr, "can't open %s\n", path);
+			return false;
+		}
+		std::string text;
+		char buffer[4096];
+		size_t size;
+		while ((size = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			text.append(buffer, size);
+		}
+		std::fclose(file);
+
+		std::istringstream lines(text);
+		std::string lineText;
+		int lineNumber = 0;
+		Mesh* mesh = nullptr;
+		while (std::getline(lines, lineText)) {
+			lineNumber++;
+			std::istringstream line(lineText);
+			std::string keyword;
+			if (!(line >> keyword) || keyword[0] == '#') {
+				continue;
+			}
+
+			bool isValid = true;
+			if (keyword == "mesh") {
+				std::string name;
+				isValid = !mesh && (line >> name) && name.size() < NAME_SIZE;
+				if (isValid) {
+					meshes.emplace_back();
+					mesh = &meshes.back();
+					mesh->name = name;
+				}
+			}
+			else if (!mesh) {
+				isValid = false;
+			}
+			else if (keyword == "end") {
+				isValid = !mesh->triangles.empty() || mesh->loop.size() >= 2;
+				mesh = nullptr;
+			}
+			else if (keyword == "rotate") {
+				isValid = readFloats(line, &mesh->rotation, 1);
+			}
+			else if (keyword == "scale") {
+				isValid = readFloats(line, &mesh->scale, 1);
+			}
+			else if (keyword == "fill") {
+				isValid = readFloats(line, mesh->fill, 3);
+			}
+			else if (keyword == "triangle") {
+				float values[6];
+				isValid = readFloats(line, values, 6);
+				for (int index = 0; isValid && index < 3; index++) {
+					mesh->triangles.push_back(Point{ values[2 * index], values[2 * index + 1] });
+				}
+			}
+			else if (keyword == "outline") {
+				float values[4];
+				isValid = readFloats(line, values, 4) && mesh->loop.empty();
+				std::copy(values, values + 3, mesh->line);
+				mesh->lineWidth = values[3];
+			}
+			else if (keyword == "loop") {
+				float values[2];
+				isValid = readFloats(line, values, 2);
+				mesh->loop.push_back(Point{ values[0], values[1] });
+			}
+			else if (keyword == "trail") {
+				float values[5];
+				isValid = readFloats(line, values, 5) && values[0] > 0.f;
+				mesh->trailInterval = values[0];
+				mesh->trailLife = values[1];
+				std::copy(values + 2, values + 5, mesh->trail);
+			}
+			else {
+				isValid = false;
+			}
+
+			if (!isValid) {
+				std::fprintf(stderr, "%s:%d: can't parse '%s'\n", path, lineNumber, lineText.c_str());
+				return false;
+			}
+		}
+		if (mesh) {
+			std::fprintf(stderr, "%s: mesh %s has no end\n", path, mesh->name.c_str());
+			return false;
+		}
+		return true;
+	}
+
+
+	//Scale first, then rotation, like the glRotatef and glScalef pair it replaces
+	Point bake(Mesh const& mesh, Point point)
+	{
+		double angle = mesh.rotation * PI / 180.0;
+		double x = point.x * mesh.scale;
+		double y = point.y * mesh.scale;
+		float bakedX = (float)(x * std::cos(angle) - y * std::sin(angle));
+		float bakedY = (float)(x * std::sin(angle) + y * std::cos(angle));
+		return Point{ std::abs(bakedX) < SNAP_TO_ZERO ? 0.f : bakedX, std::abs(bakedY) < SNAP_TO_ZERO ? 0.f : bakedY };
+	}
+
+
+	std::vector<uint8_t> writeMeshes(std::vector<Mesh> const& meshes)
+	{
+		std::vector<Point> vertices;
+		std::vector<uint8_t> directory;
+		for (Mesh const& mesh : meshes) {
+			uint32_t firstTriangleVertex = (uint32_t)vertices.size();
+			for (Point const& point : mesh.triangles) {
+				vertices.push_back(bake(mesh, point));
+			}
+			//Closed loop as segment pairs, instances of the mesh then share one draw call
+			uint32_t firstLineVertex = (uint32_t)vertices.size();
+			for (size_t index = 0; index < mesh.loop.size(); index++) {
+				vertices.push_back(bake(mesh, mesh.loop[index]));
+				vertices.push_back(bake(mesh, mesh.loop[(index + 1) % mesh.loop.size()]));
+			}
+			uint32_t endVertex = (uint32_t)vertices.size();
+
+			float minX = vertices[firstTriangleVertex].x, maxX = minX;
+			float minY = vertices[firstTriangleVertex].y, maxY = minY;
+			float radiusSquare = 0.f;
+			for (uint32_t index = firstTriangleVertex; index < endVertex; index++) {
+				Point const& vertex = vertices[index];
+				minX = std::min(minX, vertex.x);
+				maxX = std::max(maxX, vertex.x);
+				minY = std::min(minY, vertex.y);
+				maxY = std::max(maxY, vertex.y);
+				radiusSquare = std::max(radiusSquare, vertex.x * vertex.x + vertex.y * vertex.y);
+			}
+
+			char name[NAME_SIZE] = {};
+			std::memcpy(name, mesh.name.data(), mesh.name.size());
+			directory.insert(directory.end(), name, name + NAME_SIZE);
+			appendU32(directory, firstTriangleVertex);
+			appendU32(directory, firstLineVertex - firstTriangleVertex);
+			appendU32(directory, firstLineVertex);
+			appendU32(directory, endVertex - firstLineVertex);
+			for (float value : mesh.fill) {
+				appendF32(directory, value);
+			}
+			for (float value : mesh.line) {
+				appendF32(directory, value);
+			}
+			appendF32(directory, mesh.lineWidth);
+			appendF32(directory, minX);
+			appendF32(directory, minY);
+			appendF32(directory, maxX);
+			appendF32(directory, maxY);
+			appendF32(directory, std::sqrt(radiusSquare));
+			appendF32(directory, mesh.trailInterval);
+			appendF32(directory, mesh.trailLife);
+			for (float value : mesh.trail) {
+				appendF32(directory, value);
+			}
+		}
+
+		std::vector<uint8_t> bytes(FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+		appendU32(bytes, VERSION);
+		appendU32(bytes, (uint32_t)meshes.size());
+		appendU32(bytes, (uint32_t)vertices.size());
+		bytes.insert(bytes.end(), directory.begin(), directory.end());
+		for (Point const& vertex : vertices) {
+			appendF32(bytes, vertex.x);
+			appendF32(bytes, vertex.y);
+		}
+		return bytes;
+	}
+
+
+	bool writeFile(char const* path, std::vector<uint8_t> const& bytes)
+	{
+		FILE* file = std::fopen(path, "wb");
+		if (!file) {
+			std::fprintf(stderr, "can't open %s\n", path);
+			return false;
+		}
+		std::fwrite(bytes.data(), 1, bytes.size(), file);
+		bool isWritten = !std::ferror(file);
+		std::fclose(file);
+		if (!isWritten) {
+			std::fprintf(stderr, "can't write %s\n", path);
+		}
+		return isWritten;
+	}
+
+
+	bool writeEmbedded(char const* path, char const* sourcePath, std::vector<uint8_t> const& bytes)
+	{
+		std::string text = "// Generated by wots_mesh_bake from " + std::string(sourcePath) + ", don't edit.\n"
+			"// Meshes drawn when no mesh file is found next to the game.\n\n"
+			"alignas( 4 ) constexpr uint8_t DEFAULT_MESH_FILE[] = {";
+		for (size_t index = 0; index < bytes.size(); index++) {
+			char value[8];
+			std::snprintf(value, sizeof(value), "%s0x%02x,", index % 16 == 0 ? "\n\t" : " ", bytes[index]);
+			text += value;
+		}
+		text += "\n};\n";
+		return writeFile(path, std::vector<uint8_t>(text.begin(), text.end()));
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc != 3 && argc != 4) {
+		std::fprintf(stderr, "usage: wots_mesh_bake SOURCE.txt OUT.wsm [OUT_EMBEDDED.inc]\n");
+		return 1;
+	}
+	std::vector<Mesh> meshes;
+	if (!parseSource(argv[1], meshes)) {
+		return 1;
+	}
+	if (meshes.empty()) {
+		std::fprintf(stderr, "%s has no meshes\n", argv[1]);
+		return 1;
+	}
+	std::vector<uint8_t> bytes = writeMeshes(meshes);
+	if (!writeFile(argv[2], bytes) || (argc == 4 && !writeEmbedded(argv[3], argv[1], bytes))) {
+		return 1;
+	}
+	std::printf("%d meshes, %d bytes\n", (int)meshes.size(), (int)bytes.size());
+	return 0;
+}
@@ -0,0 +1,234 @@
+// Headless steady state test of the whole game.
+// Plays a scripted battle past the allocation warm-up and fails when the game or the scene
+// allocates in steady state, when scripted input misses its latency budget,
+// or when the final state hash differs from the expected one.
+// Must be built with WOTS_ALLOCATION_GUARD and framework/scene_headless.cpp. The Deterministic
+// configuration adds WOTS_DETERMINISTIC and strict floating point, and passes the lockstep hash with --hash.
+// Every configuration plays the battle on open ocean and again with --world assets/steady_state_world.wsw,
+// a dense archipelago of small chunks where carriers stream, rebase and grind along shores. It was made by
+//   wots_world_gen --chunks 16 --chunk-size 6 --islands 3 --seed 7
+// and is kept as a file, because standard library distributions differ between compilers.
+
+#include "../framework/allocation_tracker.hpp"
+#include "../framework/game.hpp"
+#include "../framework/profiler.hpp"
+#include "../framework/scene.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef WOTS_ALLOCATION_GUARD
+#error "steady state test requires WOTS_ALLOCATION_GUARD to be defined"
+#endif
+
+namespace
+{
+	namespace test
+	{
+		constexpr float SIMULATION_DT = 1.f / 60.f;
+		// Long enough for salvos, returns and landings well after the warm-up
+		constexpr int DEFAULT_STEPS = 10 * allocations::WARM_UP_STEPS;
+
+		// Scripted input, in steps
+		constexpr int LAUNCH_INTERVAL = 60;
+		constexpr int RETARGET_INTERVAL = 1500;
+		constexpr int FORWARD_STEP = 100;
+		constexpr int TURN_START_STEP = 3000;
+		constexpr int TURN_END_STEP = 6000;
+
+		// Input fed before a step is shown by the frame drawn right after it
+		constexpr uint32_t INPUT_FRAME_BUDGET = 0;
+		// One display frame, the window engine adds at most the wait for the next tick
+		constexpr float INPUT_TO_PRESENT_BUDGET_SECONDS = 1.f / 60.f;
+	}
+
+	struct Settings
+	{
+		int steps = test::DEFAULT_STEPS;
+		bool isHashExpected = false;
+		uint32_t expectedHash = 0;
+		// The rest goes to the game, so outputs like telemetry are checked for allocations too
+		std::vector<char*> gameArguments;
+	};
+
+
+	void printUsage()
+	{
+		std::printf("usage: wots_steady_state_test [--steps N] [--hash HEX] [game options]\n");
+	}
+
+
+	bool parseArguments(int argc, char** argv, Settings& settings)
+	{
+		settings.gameArguments.push_back(argv[0]);
+		for (int index = 1; index < argc; index++) {
+			char const* option = argv[index];
+			if (index + 1 >= argc) {
+				return false;
+			}
+			char const* value = argv[++index];
+			if (std::strcmp(option, "--steps") == 0) {
+				settings.steps = std::atoi(value);
+			}
+			else if (std::strcmp(option, "--hash") == 0) {
+				settings.expectedHash = (uint32_t)std::strtoul(value, nullptr, 16);
+				settings.isHashExpected = true;
+			}
+			else {
+				settings.gameArguments.push_back(argv[index - 1]);
+				settings.gameArguments.push_back(argv[index]);
+			}
+		}
+		return settings.steps > allocations::WARM_UP_STEPS
+			&& game::parseArguments((int)settings.gameArguments.size(), settings.gameArguments.data());
+	}
+
+
+	// Stamped like window events, so the latency timings cover the scripted input
+	void stampedMouseClick(float x, float y, bool isLeftButton)
+	{
+		profiler::inputReceived(0.f);
+		game::mouseClicked(x, y, isLeftButton);
+	}
+
+
+	void stampedKeyPress(int key)
+	{
+		profiler::inputReceived(0.f);
+		game::keyPressed(key);
+	}
+
+
+	void stampedKeyRelease(int key)
+	{
+		profiler::inputReceived(0.f);
+		game::keyReleased(key);
+	}
+
+
+	// Launches, retargets and steering cover every aircraft status and carrier turns.
+	// Returns whether any input was fed
+	bool feedInput(int step)
+	{
+		bool isFed = false;
+		if (step == 0) {
+			stampedMouseClick(0.7f, 0.7f, true);
+			isFed = true;
+		}
+		if (step % test::LAUNCH_INTERVAL == 0) {
+			stampedMouseClick(0.5f, 0.5f, false);
+			isFed = true;
+		}
+		if (step % test::RETARGET_INTERVAL == 0) {
+			stampedMouseClick(0.2f + (step % 7) * 0.1f, 0.3f + (step % 5) * 0.1f, true);
+			isFed = true;
+		}
+		if (step == test::FORWARD_STEP) {
+			stampedKeyPress(game::KEY_FORWARD);
+			isFed = true;
+		}
+		if (step == test::TURN_START_STEP) {
+			stampedKeyPress(game::KEY_LEFT);
+			isFed = true;
+		}
+		if (step == test::TURN_END_STEP) {
+			stampedKeyRelease(game::KEY_LEFT);
+			isFed = true;
+		}
+		return isFed;
+	}
+
+
+	// Same scopes as one engine tick without time warp
+	void runStep(bool isSteadyState)
+	{
+		scene::beginStep();
+		{
+			allocations::Scope allocationScope(allocations::SUBSYSTEM_GAME);
+			allocations::SteadyStateScope steadyStateScope(isSteadyState);
+			game::update(test::SIMULATION_DT);
+			game::prepareDraw();
+		}
+		{
+			allocations::Scope allocationScope(allocations::SUBSYSTEM_SCENE);
+			allocations::SteadyStateScope steadyStateScope(isSteadyState);
+			scene::update(test::SIMULATION_DT);
+		}
+		{
+			allocations::Scope allocationScope(allocations::SUBSYSTEM_SCENE);
+			scene::draw(0.5f);
+		}
+		allocations::endFrame();
+	}
+
+
+	// Percentiles and the histogram of the sliding window, the scripted input fits into it
+	void printLatency(char const* name, profiler::Timing timing)
+	{
+		profiler::Percentiles percentiles = profiler::getPercentiles(timing);
+		profiler::Histogram histogram = profiler::getHistogram(timing);
+		std::printf("%-17s P50 %6.3f  P95 %6.3f  P99 %6.3f ms, under 1 2 4 .. 256 ms and longer:", name,
+			percentiles.p50 * 1000.f, percentiles.p95 * 1000.f, percentiles.p99 * 1000.f);
+		for (int count : histogram.bucketCounts) {
+			std::printf(" %d", count);
+		}
+		std::printf("\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	if (!parseArguments(argc, argv, settings)) {
+		printUsage();
+		return 1;
+	}
+
+	game::init();
+	int firstViolationStep = -1;
+	int lateInputCount = 0;
+	int firstLateInputStep = -1;
+	for (int step = 0; step < settings.steps; step++) {
+		bool isInputFed = feedInput(step);
+		runStep(step >= allocations::WARM_UP_STEPS);
+		if (firstViolationStep < 0 && allocations::getSteadyStateViolationCount() > 0) {
+			firstViolationStep = step;
+		}
+		if (isInputFed && profiler::getPresentedFrameCount() - profiler::getLastInputFrame() > test::INPUT_FRAME_BUDGET) {
+			if (firstLateInputStep < 0) {
+				firstLateInputStep = step;
+			}
+			lateInputCount++;
+		}
+	}
+	uint32_t hash = game::getStateHash();
+	game::deinit();
+
+	int64_t violations = allocations::getSteadyStateViolationCount();
+	std::printf("%d steps, %lld steady state allocations, state hash %08x\n", settings.steps, (long long)violations, hash);
+	printLatency("input to step", profiler::TIMING_INPUT_TO_STEP);
+	printLatency("step to present", profiler::TIMING_STEP_TO_PRESENT);
+	printLatency("input to present", profiler::TIMING_INPUT_TO_PRESENT);
+	bool isPassed = true;
+	if (violations > 0) {
+		std::printf("FAILED: allocations in steady state, first at step %d\n", firstViolationStep);
+		isPassed = false;
+	}
+	if (lateInputCount > 0) {
+		std::printf("FAILED: %d inputs shown more than %u frames late, first at step %d\n", lateInputCount, test::INPUT_FRAME_BUDGET, firstLateInputStep);
+		isPassed = false;
+	}
+	float inputToPresent = profiler::getPercentiles(profiler::TIMING_INPUT_TO_PRESENT).p99;
+	if (inputToPresent > test::INPUT_TO_PRESENT_BUDGET_SECONDS) {
+		std::printf("FAILED: input to present P99 %.3f ms over the %.3f ms budget\n", inputToPresent * 1000.f, test::INPUT_TO_PRESENT_BUDGET_SECONDS * 1000.f);
+		isPassed = false;
+	}
+	if (settings.isHashExpected && hash != settings.expectedHash) {
+		std::printf("FAILED: state hash differs from the expected %08x\n", settings.expectedHash);
+		isPassed = false;
+	}
+	return isPassed ? 0 : 1;
+}
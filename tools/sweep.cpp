@@ -0,0 +1,343 @@
+// Monte-Carlo sweep of params::aircraft tuning parameters.
+// Runs independent headless simulations on all cores and writes one table row per run.
+// Must be built with WOTS_TUNABLE_PARAMS and framework/scene_headless.cpp.
+
+#include "../game_cpp/ship.h"
+#include "../game_cpp/aircraft.h"
+#include "../game_cpp/return_cost.h"
+#include "../game_cpp/transforms.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef WOTS_TUNABLE_PARAMS
+#error "sweep requires WOTS_TUNABLE_PARAMS to be defined"
+#endif
+
+namespace
+{
+	namespace sweep
+	{
+		constexpr float SIMULATION_DT = 1.f / 60.f;
+		constexpr float DEFAULT_DURATION = 180.f;
+		constexpr int DEFAULT_RUNS = 1000;
+		constexpr float DEFAULT_RANGE_FRACTION = 0.25f;
+
+		constexpr float LAUNCH_INTERVAL = 1.f;
+		constexpr float RETARGET_INTERVAL = 20.f;
+		constexpr float STEERING_INTERVAL = 4.f;
+		constexpr float TARGET_AREA_WIDTH = 14.f;
+		constexpr float TARGET_AREA_HEIGHT = 10.f;
+
+		// Aircraft counts as patrolling while it is that close to the patrol circle
+		constexpr float PATROL_RADIUS_TOLERANCE = 0.05f;
+	}
+
+#define WOTS_PARAM_NAME( name, value ) #name,
+#define WOTS_PARAM_DEFAULT( name, value ) value,
+	char const* const PARAM_NAMES[] = { WOTS_AIRCRAFT_TUNABLE_PARAMS(WOTS_PARAM_NAME) };
+	float const PARAM_DEFAULTS[] = { WOTS_AIRCRAFT_TUNABLE_PARAMS(WOTS_PARAM_DEFAULT) };
+#undef WOTS_PARAM_NAME
+#undef WOTS_PARAM_DEFAULT
+	constexpr int PARAM_COUNT = sizeof(PARAM_DEFAULTS) / sizeof(PARAM_DEFAULTS[0]);
+
+	struct ParamRange
+	{
+		float min;
+		float max;
+	};
+
+	struct RunResult
+	{
+		float params[PARAM_COUNT];
+		int landings = 0;
+		int missedLandings = 0;
+		float airborneTime = 0.f;
+		float patrolTime = 0.f;
+		float fuelMarginSum = 0.f;
+		float minFuelMargin = params::aircraft::MAXIMAL_FLIGHT_TIME;
+	};
+
+	struct Settings
+	{
+		int runs = sweep::DEFAULT_RUNS;
+		int threads = 0;
+		unsigned seed = 1;
+		float duration = sweep::DEFAULT_DURATION;
+		std::string output = "sweep_results.csv";
+		ParamRange ranges[PARAM_COUNT];
+	};
+
+
+	// Assigns this thread's copy of the tunable parameters
+	void applyParams(float const* values)
+	{
+		int index = 0;
+#define WOTS_APPLY_PARAM( name, value ) params::aircraft::name = values[index++];
+		WOTS_AIRCRAFT_TUNABLE_PARAMS(WOTS_APPLY_PARAM)
+#undef WOTS_APPLY_PARAM
+	}
+
+
+	bool isAirborne(AircraftStatus status)
+	{
+		return status == TakeOff || status == LayInACourse || status == Returning;
+	}
+
+
+	Vector2 randomTarget(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> horizontal(-0.5f * sweep::TARGET_AREA_WIDTH, 0.5f * sweep::TARGET_AREA_WIDTH);
+		std::uniform_real_distribution<float> vertical(-0.5f * sweep::TARGET_AREA_HEIGHT, 0.5f * sweep::TARGET_AREA_HEIGHT);
+		float x = horizontal(random);
+		return Vector2(x, vertical(random));
+	}
+
+
+	void steerRandomly(Ship& ship, std::mt19937& random)
+	{
+		ship.keyReleased(game::KEY_LEFT);
+		ship.keyReleased(game::KEY_RIGHT);
+		switch (std::uniform_int_distribution<int>(0, 2)(random)) {
+		case 1:
+			ship.keyPressed(game::KEY_LEFT);
+			break;
+		case 2:
+			ship.keyPressed(game::KEY_RIGHT);
+			break;
+		}
+	}
+
+
+	// One headless play session: the ship sails a random course, launches aircraft
+	// as soon as they are ready and retargets them periodically.
+	void simulate(Settings const& settings, int run, RunResult& result)
+	{
+		std::seed_seq seed{ settings.seed, (unsigned)run };
+		std::mt19937 random(seed);
+
+		for (int index = 0; index < PARAM_COUNT; index++) {
+			std::uniform_real_distribution<float> distribution(settings.ranges[index].min, settings.ranges[index].max);
+			result.params[index] = distribution(random);
+		}
+		applyParams(result.params);
+		prepareReturnCostTable();
+
+		Ship ship;
+		ship.init();
+		ship.keyPressed(game::KEY_FORWARD);
+
+		int aircraftCount = ship.getAircraftCount();
+		std::vector<AircraftStatus> previousStatus(aircraftCount, ReadyToFlight);
+		std::vector<bool> isFuelExhausted(aircraftCount, false);
+
+		Vector2 target = randomTarget(random);
+		ship.mouseClicked(target, true);
+
+		float launchTimeout = 0.f;
+		float retargetTimeout = sweep::RETARGET_INTERVAL;
+		float steeringTimeout = 0.f;
+		float patrolRadius = params::aircraft::PATROL_RADIUS;
+
+		for (float time = 0.f; time < settings.duration; time += sweep::SIMULATION_DT) {
+			launchTimeout -= sweep::SIMULATION_DT;
+			if (launchTimeout <= 0.f) {
+				launchTimeout += sweep::LAUNCH_INTERVAL;
+				ship.mouseClicked(target, false);
+			}
+			retargetTimeout -= sweep::SIMULATION_DT;
+			if (retargetTimeout <= 0.f) {
+				retargetTimeout += sweep::RETARGET_INTERVAL;
+				target = randomTarget(random);
+				ship.mouseClicked(target, true);
+			}
+			steeringTimeout -= sweep::SIMULATION_DT;
+			if (steeringTimeout <= 0.f) {
+				steeringTimeout += sweep::STEERING_INTERVAL;
+				steerRandomly(ship, random);
+			}
+
+			ship.update(sweep::SIMULATION_DT);
+			transforms::endFrame();
+
+			for (int index = 0; index < aircraftCount; index++) {
+				Aircraft& aircraft = ship.getAircraft(index);
+				AircraftStatus status = aircraft.getStatus();
+
+				if (isAirborne(status)) {
+					result.airborneTime += sweep::SIMULATION_DT;
+					float distanceToTarget = std::sqrt((target - aircraft.getPosition()).lengthSquare());
+					if (status == LayInACourse && std::abs(distanceToTarget - patrolRadius) < sweep::PATROL_RADIUS_TOLERANCE * patrolRadius) {
+						result.patrolTime += sweep::SIMULATION_DT;
+					}
+					if (!isFuelExhausted[index] && aircraft.getFlightTime() > params::aircraft::MAXIMAL_FLIGHT_TIME) {
+						isFuelExhausted[index] = true;
+						result.missedLandings++;
+					}
+				}
+				if (previousStatus[index] == Returning && status == Fuelling) {
+					float fuelMargin = params::aircraft::MAXIMAL_FLIGHT_TIME - aircraft.getFlightTime();
+					result.landings++;
+					result.fuelMarginSum += fuelMargin;
+					result.minFuelMargin = std::min(result.minFuelMargin, fuelMargin);
+					isFuelExhausted[index] = false;
+				}
+				previousStatus[index] = status;
+			}
+		}
+
+		ship.deinit();
+	}
+
+
+	void runWorker(Settings const& settings, std::atomic<int>& nextRun, std::vector<RunResult>& results)
+	{
+		while (true) {
+			int run = nextRun.fetch_add(1);
+			if (run >= settings.runs) {
+				return;
+			}
+			simulate(settings, run, results[run]);
+		}
+	}
+
+
+	bool writeResults(Settings const& settings, std::vector<RunResult> const& results)
+	{
+		FILE* file = std::fopen(settings.output.c_str(), "w");
+		if (!file) {
+			std::fprintf(stderr, "can't open %s\n", settings.output.c_str());
+			return false;
+		}
+
+		std::fprintf(file, "run");
+		for (char const* name : PARAM_NAMES) {
+			std::fprintf(file, ",%s", name);
+		}
+		std::fprintf(file, ",landings,missed_landings,patrol_time_fraction,mean_fuel_margin,min_fuel_margin\n");
+
+		for (int run = 0; run < (int)results.size(); run++) {
+			RunResult const& result = results[run];
+			std::fprintf(file, "%d", run);
+			for (float value : result.params) {
+				std::fprintf(file, ",%g", value);
+			}
+			float patrolFraction = result.airborneTime > 0.f ? result.patrolTime / result.airborneTime : 0.f;
+			float meanFuelMargin = result.landings > 0 ? result.fuelMarginSum / result.landings : 0.f;
+			float minFuelMargin = result.landings > 0 ? result.minFuelMargin : 0.f;
+			std::fprintf(file, ",%d,%d,%g,%g,%g\n", result.landings, result.missedLandings, patrolFraction, meanFuelMargin, minFuelMargin);
+		}
+
+		std::fclose(file);
+		return true;
+	}
+
+
+	void printUsage()
+	{
+		std::printf("usage: wots_sweep [--runs N] [--threads N] [--seed N] [--duration SECONDS] [--out FILE] [--range NAME=MIN:MAX]...\n");
+		std::printf("tunable parameters:");
+		for (int index = 0; index < PARAM_COUNT; index++) {
+			std::printf(" %s(%g)", PARAM_NAMES[index], PARAM_DEFAULTS[index]);
+		}
+		std::printf("\n");
+	}
+
+
+	bool parseRange(char const* argument, Settings& settings)
+	{
+		char const* separator = std::strchr(argument, '=');
+		if (!separator) {
+			return false;
+		}
+		std::string name(argument, separator);
+		for (int index = 0; index < PARAM_COUNT; index++) {
+			if (name == PARAM_NAMES[index]) {
+				ParamRange& range = settings.ranges[index];
+				return std::sscanf(separator + 1, "%f:%f", &range.min, &range.max) == 2 && range.min <= range.max;
+			}
+		}
+		return false;
+	}
+
+
+	bool parseArguments(int argc, char** argv, Settings& settings)
+	{
+		for (int index = 0; index < PARAM_COUNT; index++) {
+			settings.ranges[index].min = PARAM_DEFAULTS[index] * (1.f - sweep::DEFAULT_RANGE_FRACTION);
+			settings.ranges[index].max = PARAM_DEFAULTS[index] * (1.f + sweep::DEFAULT_RANGE_FRACTION);
+		}
+
+		for (int index = 1; index < argc; index++) {
+			char const* option = argv[index];
+			if (index + 1 >= argc) {
+				return false;
+			}
+			char const* value = argv[++index];
+			if (std::strcmp(option, "--runs") == 0) {
+				settings.runs = std::atoi(value);
+			}
+			else if (std::strcmp(option, "--threads") == 0) {
+				settings.threads = std::atoi(value);
+			}
+			else if (std::strcmp(option, "--seed") == 0) {
+				settings.seed = (unsigned)std::strtoul(value, nullptr, 10);
+			}
+			else if (std::strcmp(option, "--duration") == 0) {
+				settings.duration = (float)std::atof(value);
+			}
+			else if (std::strcmp(option, "--out") == 0) {
+				settings.output = value;
+			}
+			else if (std::strcmp(option, "--range") == 0) {
+				if (!parseRange(value, settings)) {
+					return false;
+				}
+			}
+			else {
+				return false;
+			}
+		}
+
+		if (settings.threads <= 0) {
+			settings.threads = std::max(1, (int)std::thread::hardware_concurrency());
+		}
+		return settings.runs > 0 && settings.duration > 0.f;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	if (!parseArguments(argc, argv, settings)) {
+		printUsage();
+		return 1;
+	}
+
+	// Every run owns its result slot, workers share nothing but the run counter
+	std::vector<RunResult> results(settings.runs);
+	std::atomic<int> nextRun(0);
+
+	auto startTime = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int index = 0; index < settings.threads; index++) {
+		workers.emplace_back(runWorker, std::cref(settings), std::ref(nextRun), std::ref(results));
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	std::printf("%d runs on %d threads in %.2f s (%.1f runs/s)\n", settings.runs, settings.threads, elapsed, settings.runs / elapsed);
+	return writeResults(settings, results) ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+// Decodes a telemetry file written by the game into CSV on stdout:
+// one line per aircraft per frame.
+
+#include "../game_cpp/telemetry_format.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace telemetry::format;
+
+	class Reader
+	{
+	public:
+		Reader(FILE* file) :
+			_file(file)
+		{
+		}
+
+		bool readBytes(void* data, size_t size) {
+			return std::fread(data, 1, size, _file) == size;
+		}
+
+		bool readU8(uint8_t* value) {
+			return readBytes(value, 1);
+		}
+
+		bool readU32(uint32_t* value) {
+			uint8_t bytes[4];
+			if (!readBytes(bytes, sizeof(bytes))) {
+				return false;
+			}
+			*value = bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+			return true;
+		}
+
+	private:
+		FILE* _file;
+	};
+
+
+	float bitsToFloat(uint32_t bits)
+	{
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+
+	bool decodeFloatDelta(std::vector<uint8_t> const& bytes, std::vector<uint32_t> const& frameRows, std::vector<float>& values)
+	{
+		std::vector<uint32_t> previous;
+		size_t position = 0;
+		for (uint32_t rows : frameRows) {
+			if (previous.size() < rows) {
+				previous.resize(rows, 0u);
+			}
+			for (uint32_t row = 0; row < rows; row++) {
+				uint32_t zigzag = 0;
+				for (int shift = 0; ; shift += 7) {
+					if (position >= bytes.size() || shift > 28) {
+						return false;
+					}
+					uint8_t byte = bytes[position++];
+					zigzag |= (uint32_t)(byte & 0x7f) << shift;
+					if (!(byte & 0x80)) {
+						break;
+					}
+				}
+				uint32_t delta = (zigzag >> 1) ^ (0u - (zigzag & 1));
+				previous[row] += delta;
+				values.push_back(bitsToFloat(previous[row]));
+			}
+		}
+		return true;
+	}
+
+
+	bool decodePacked3Bits(std::vector<uint8_t> const& bytes, uint32_t count, std::vector<float>& values)
+	{
+		if ((size_t)count * 3 > bytes.size() * 8) {
+			return false;
+		}
+		for (uint32_t index = 0; index < count; index++) {
+			size_t bit = (size_t)index * 3;
+			uint32_t word = bytes[bit / 8];
+			if (bit / 8 + 1 < bytes.size()) {
+				word |= (uint32_t)bytes[bit / 8 + 1] << 8;
+			}
+			values.push_back((float)((word >> (bit % 8)) & 7));
+		}
+		return true;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc != 2) {
+		std::fprintf(stderr, "usage: wots_telemetry_dump FILE\n");
+		return 1;
+	}
+	FILE* file = std::fopen(argv[1], "rb");
+	if (!file) {
+		std::fprintf(stderr, "can't open %s\n", argv[1]);
+		return 1;
+	}
+	Reader reader(file);
+
+	char magic[sizeof(FILE_MAGIC)];
+	uint32_t version, columnCount;
+	if (!reader.readBytes(magic, sizeof(magic)) || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 ||
+		!reader.readU32(&version) || version != VERSION || !reader.readU32(&columnCount)) {
+		std::fprintf(stderr, "%s is not a telemetry file\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<uint8_t> encodings(columnCount);
+	std::printf("frame,time,row");
+	for (uint32_t column = 0; column < columnCount; column++) {
+		uint8_t nameLength;
+		char name[256];
+		if (!reader.readU8(&encodings[column]) || !reader.readU8(&nameLength) || !reader.readBytes(name, nameLength)) {
+			std::fprintf(stderr, "truncated header\n");
+			return 1;
+		}
+		std::printf(",%s", std::string(name, nameLength).c_str());
+	}
+	std::printf("\n");
+
+	uint32_t frameIndex = 0;
+	uint32_t chunkMagic;
+	while (reader.readU32(&chunkMagic)) {
+		uint32_t frameCount, rowCount;
+		if (chunkMagic != CHUNK_MAGIC || !reader.readU32(&frameCount) || !reader.readU32(&rowCount)) {
+			std::fprintf(stderr, "corrupted chunk\n");
+			return 1;
+		}
+		std::vector<float> frameTimes(frameCount);
+		std::vector<uint32_t> frameRows(frameCount);
+		for (uint32_t frame = 0; frame < frameCount; frame++) {
+			uint32_t timeBits;
+			if (!reader.readU32(&timeBits) || !reader.readU32(&frameRows[frame])) {
+				std::fprintf(stderr, "truncated chunk\n");
+				return 1;
+			}
+			frameTimes[frame] = bitsToFloat(timeBits);
+		}
+
+		std::vector<std::vector<float>> columns(columnCount);
+		for (uint32_t column = 0; column < columnCount; column++) {
+			uint32_t byteSize;
+			std::vector<uint8_t> bytes;
+			bool isValid = reader.readU32(&byteSize);
+			if (isValid) {
+				bytes.resize(byteSize);
+				isValid = reader.readBytes(bytes.data(), byteSize);
+			}
+			if (isValid) {
+				isValid = encodings[column] == FloatDelta ? decodeFloatDelta(bytes, frameRows, columns[column]) :
+					encodings[column] == Packed3Bits ? decodePacked3Bits(bytes, rowCount, columns[column]) : false;
+			}
+			if (!isValid || columns[column].size() != rowCount) {
+				std::fprintf(stderr, "corrupted column %u\n", column);
+				return 1;
+			}
+		}
+
+		size_t row = 0;
+		for (uint32_t frame = 0; frame < frameCount; frame++, frameIndex++) {
+			for (uint32_t frameRow = 0; frameRow < frameRows[frame]; frameRow++, row++) {
+				std::printf("%u,%g,%u", frameIndex, frameTimes[frame], frameRow);
+				for (uint32_t column = 0; column < columnCount; column++) {
+					std::printf(",%g", columns[column][row]);
+				}
+				std::printf("\n");
+			}
+		}
+	}
+
+	std::fclose(file);
+	return 0;
+}
@@ -0,0 +1,247 @@
+// Generates a random world file for the game: islands, sea currents and
+// enemy spawn points on a square of chunks centred at the world origin.
+// Every chunk is generated from its own seed, so the output doesn't depend
+// on generation order, and only the chunk directory is kept in memory.
+
+#include "../game_cpp/world_format.h"
+#include "../game_cpp/supporting_function.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace world::format;
+
+	namespace generator
+	{
+		constexpr int DEFAULT_CHUNKS = 64;
+		constexpr float DEFAULT_CHUNK_SIZE = 24.f;
+		constexpr int DEFAULT_MAX_ISLANDS = 4;
+		constexpr float DEFAULT_CURRENT = 0.05f;
+
+		constexpr float MIN_ISLAND_RADIUS = 0.3f;
+		constexpr float MAX_ISLAND_RADIUS = 2.f;
+		// Player starts at the origin, there must be room to sail away
+		constexpr float START_CLEARANCE = 8.f;
+		constexpr float SPAWN_PROBABILITY = 0.5f;
+		constexpr int SPAWN_ATTEMPTS = 8;
+		// Keeps spawned carriers off the island shores and off the player
+		constexpr float SPAWN_CLEARANCE = 1.f;
+		constexpr float SPAWN_MIN_START_DISTANCE = 4.f;
+	}
+
+	struct Settings
+	{
+		int chunks = generator::DEFAULT_CHUNKS;
+		float chunkSize = generator::DEFAULT_CHUNK_SIZE;
+		int maxIslands = generator::DEFAULT_MAX_ISLANDS;
+		float current = generator::DEFAULT_CURRENT;
+		unsigned seed = 1;
+		std::string output = "world.wsw";
+	};
+
+	struct Island
+	{
+		float x;
+		float y;
+		float radius;
+	};
+
+
+	void appendU32(std::vector<uint8_t>& bytes, uint32_t value)
+	{
+		for (int shift = 0; shift < 32; shift += 8) {
+			bytes.push_back((uint8_t)(value >> shift));
+		}
+	}
+
+
+	void appendF32(std::vector<uint8_t>& bytes, float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		appendU32(bytes, bits);
+	}
+
+
+	bool isClearOfIslands(std::vector<Island> const& islands, float x, float y, float clearance)
+	{
+		for (Island const& island : islands) {
+			float reach = island.radius + clearance;
+			if ((x - island.x) * (x - island.x) + (y - island.y) * (y - island.y) < reach * reach) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	void generateChunk(Settings const& settings, int32_t chunkX, int32_t chunkY, std::vector<uint8_t>& bytes)
+	{
+		std::seed_seq seed = { settings.seed, (unsigned)chunkX, (unsigned)chunkY };
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		float cornerX = chunkX * settings.chunkSize;
+		float cornerY = chunkY * settings.chunkSize;
+
+		float currentAngle = 2.f * params::precision::PI_CONST * unit(random);
+		float currentStrength = settings.current * unit(random);
+		appendF32(bytes, currentStrength * std::cos(currentAngle));
+		appendF32(bytes, currentStrength * std::sin(currentAngle));
+
+		// Islands lie entirely inside their chunk, so area queries only visit overlapping chunks
+		std::vector<Island> islands;
+		int islandCount = std::uniform_int_distribution<int>(0, settings.maxIslands)(random);
+		for (int index = 0; index < islandCount; index++) {
+			Island island;
+			island.radius = generator::MIN_ISLAND_RADIUS + (generator::MAX_ISLAND_RADIUS - generator::MIN_ISLAND_RADIUS) * unit(random);
+			island.x = island.radius + (settings.chunkSize - 2.f * island.radius) * unit(random);
+			island.y = island.radius + (settings.chunkSize - 2.f * island.radius) * unit(random);
+			float worldX = cornerX + island.x;
+			float worldY = cornerY + island.y;
+			if (std::sqrt(worldX * worldX + worldY * worldY) < generator::START_CLEARANCE + island.radius) {
+				continue;
+			}
+			islands.push_back(island);
+		}
+		appendU32(bytes, (uint32_t)islands.size());
+		for (Island const& island : islands) {
+			appendF32(bytes, island.x);
+			appendF32(bytes, island.y);
+			appendF32(bytes, island.radius);
+		}
+
+		uint32_t spawnCount = 0;
+		float spawnX = 0.f;
+		float spawnY = 0.f;
+		if (unit(random) < generator::SPAWN_PROBABILITY) {
+			for (int attempt = 0; attempt < generator::SPAWN_ATTEMPTS && spawnCount == 0; attempt++) {
+				spawnX = settings.chunkSize * unit(random);
+				spawnY = settings.chunkSize * unit(random);
+				float worldX = cornerX + spawnX;
+				float worldY = cornerY + spawnY;
+				bool isFarFromStart = worldX * worldX + worldY * worldY >= generator::SPAWN_MIN_START_DISTANCE * generator::SPAWN_MIN_START_DISTANCE;
+				if (isFarFromStart && isClearOfIslands(islands, spawnX, spawnY, generator::SPAWN_CLEARANCE)) {
+					spawnCount = 1;
+				}
+			}
+		}
+		appendU32(bytes, spawnCount);
+		if (spawnCount > 0) {
+			appendF32(bytes, spawnX);
+			appendF32(bytes, spawnY);
+			appendF32(bytes, 2.f * params::precision::PI_CONST * unit(random));
+		}
+	}
+
+
+	bool writeWorld(Settings const& settings)
+	{
+		FILE* file = std::fopen(settings.output.c_str(), "wb");
+		if (!file) {
+			std::fprintf(stderr, "can't open %s\n", settings.output.c_str());
+			return false;
+		}
+
+		int32_t firstChunk = -settings.chunks / 2;
+		std::vector<uint8_t> bytes(FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+		appendU32(bytes, VERSION);
+		appendF32(bytes, settings.chunkSize);
+		appendU32(bytes, (uint32_t)firstChunk);
+		appendU32(bytes, (uint32_t)firstChunk);
+		appendU32(bytes, (uint32_t)settings.chunks);
+		appendU32(bytes, (uint32_t)settings.chunks);
+		std::fwrite(bytes.data(), 1, bytes.size(), file);
+
+		// Directory is written after the chunks, once their offsets are known
+		size_t chunkCount = (size_t)settings.chunks * settings.chunks;
+		std::vector<uint8_t> directory(chunkCount * DIRECTORY_ENTRY_SIZE, 0);
+		std::fwrite(directory.data(), 1, directory.size(), file);
+
+		uint64_t offset = HEADER_SIZE + directory.size();
+		directory.clear();
+		for (int32_t chunkY = firstChunk; chunkY < firstChunk + settings.chunks; chunkY++) {
+			for (int32_t chunkX = firstChunk; chunkX < firstChunk + settings.chunks; chunkX++) {
+				bytes.clear();
+				generateChunk(settings, chunkX, chunkY, bytes);
+				std::fwrite(bytes.data(), 1, bytes.size(), file);
+				appendU32(directory, (uint32_t)offset);
+				appendU32(directory, (uint32_t)(offset >> 32));
+				appendU32(directory, (uint32_t)bytes.size());
+				offset += bytes.size();
+			}
+		}
+
+		std::fseek(file, HEADER_SIZE, SEEK_SET);
+		std::fwrite(directory.data(), 1, directory.size(), file);
+		bool isWritten = !std::ferror(file);
+		std::fclose(file);
+		if (!isWritten) {
+			std::fprintf(stderr, "can't write %s\n", settings.output.c_str());
+		}
+		return isWritten;
+	}
+
+
+	void printUsage()
+	{
+		std::printf("usage: wots_world_gen [--chunks N] [--chunk-size UNITS] [--islands MAX_PER_CHUNK] [--current MAX] [--seed N] [--out FILE]\n");
+	}
+
+
+	bool parseArguments(int argc, char** argv, Settings& settings)
+	{
+		for (int index = 1; index < argc; index++) {
+			char const* option = argv[index];
+			if (index + 1 >= argc) {
+				return false;
+			}
+			char const* value = argv[++index];
+			if (std::strcmp(option, "--chunks") == 0) {
+				settings.chunks = std::atoi(value);
+			}
+			else if (std::strcmp(option, "--chunk-size") == 0) {
+				settings.chunkSize = (float)std::atof(value);
+			}
+			else if (std::strcmp(option, "--islands") == 0) {
+				settings.maxIslands = std::atoi(value);
+			}
+			else if (std::strcmp(option, "--current") == 0) {
+				settings.current = (float)std::atof(value);
+			}
+			else if (std::strcmp(option, "--seed") == 0) {
+				settings.seed = (unsigned)std::strtoul(value, nullptr, 10);
+			}
+			else if (std::strcmp(option, "--out") == 0) {
+				settings.output = value;
+			}
+			else {
+				return false;
+			}
+		}
+		return settings.chunks > 0 && settings.chunkSize > 2.f * generator::MAX_ISLAND_RADIUS && settings.maxIslands >= 0 &&
+			settings.current >= 0.f && settings.current <= params::world::MAXIMAL_SEA_CURRENT;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	if (!parseArguments(argc, argv, settings)) {
+		printUsage();
+		return 1;
+	}
+	if (!writeWorld(settings)) {
+		return 1;
+	}
+	std::printf("%d x %d chunks of %g units written to %s\n", settings.chunks, settings.chunks, settings.chunkSize, settings.output.c_str());
+	return 0;
+}
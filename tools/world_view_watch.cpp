@@ -0,0 +1,105 @@
+// Example world view reader: follows a running game and prints a fleet summary
+// twice a second. Usage: wots_world_view_watch [NAME]
+
+#include "../game_cpp/world_view_reader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	using namespace world_view::format;
+
+	constexpr auto PRINT_INTERVAL = std::chrono::milliseconds(500);
+	constexpr uint32_t MAX_SHIPS_PRINTED = 16;
+	//AircraftStatus values, the tool doesn't link the game
+	constexpr int STATUS_COUNT = 5;
+	constexpr char const* STATUS_NAMES[STATUS_COUNT] = { "ready", "takeoff", "course", "returning", "fuelling" };
+
+	struct ShipSummary
+	{
+		float x;
+		float y;
+		float angle;
+		int statusCounts[STATUS_COUNT];
+	};
+
+	struct FrameSummary
+	{
+		uint32_t frame;
+		float time;
+		int32_t originChunkX;
+		int32_t originChunkY;
+		uint32_t shipCount;
+		ShipSummary ships[MAX_SHIPS_PRINTED];
+	};
+
+
+	//Everything printed is gathered first, so nothing is printed from a frame that turns out torn
+	void summarize(WorldViewReader::Frame const& frame, FrameSummary* summary)
+	{
+		summary->frame = frame.header->frame;
+		summary->time = frame.header->time;
+		summary->originChunkX = frame.header->originChunkX;
+		summary->originChunkY = frame.header->originChunkY;
+		summary->shipCount = frame.shipCount < MAX_SHIPS_PRINTED ? frame.shipCount : MAX_SHIPS_PRINTED;
+		for (uint32_t index = 0; index < summary->shipCount; index++) {
+			summary->ships[index] = ShipSummary{ frame.ships[index].x, frame.ships[index].y, frame.ships[index].angle, {} };
+		}
+		for (uint32_t index = 0; index < frame.aircraftCount; index++) {
+			AircraftRecord const& aircraft = frame.aircraft[index];
+			if (aircraft.shipIndex < summary->shipCount && aircraft.status < STATUS_COUNT) {
+				summary->ships[aircraft.shipIndex].statusCounts[aircraft.status]++;
+			}
+		}
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	char const* name = argc > 1 ? argv[1] : "wots_world_view";
+	WorldViewReader reader;
+	uint32_t lastFrame = 0;
+	int tornReads = 0;
+
+	while (true) {
+		std::this_thread::sleep_for(PRINT_INTERVAL);
+		if (!reader.isOpen() && !reader.open(name)) {
+			std::printf("waiting for the game to publish %s\n", name);
+			continue;
+		}
+
+		WorldViewReader::Frame frame;
+		FrameSummary summary;
+		bool isAcquired;
+		int attempts = 0;
+		do {
+			isAcquired = reader.acquire(&frame);
+			if (isAcquired) {
+				summarize(frame, &summary);
+				attempts++;
+			}
+		} while (isAcquired && !reader.isValid(frame));
+
+		if (!isAcquired) {
+			//The game stopped or hasn't published its first frame yet
+			reader.close();
+			continue;
+		}
+		tornReads += attempts - 1;
+		std::printf("frame %u (+%u) time %.1f origin chunk %d %d, torn reads so far %d\n", summary.frame, summary.frame - lastFrame,
+			summary.time, summary.originChunkX, summary.originChunkY, tornReads);
+		lastFrame = summary.frame;
+		for (uint32_t index = 0; index < summary.shipCount; index++) {
+			ShipSummary const& ship = summary.ships[index];
+			std::printf("  ship %u%s at %.2f %.2f heading %.2f, aircraft", index, index == 0 ? " (player)" : "", ship.x, ship.y, ship.angle);
+			for (int status = 0; status < STATUS_COUNT; status++) {
+				std::printf(" %s %d", STATUS_NAMES[status], ship.statusCounts[status]);
+			}
+			std::printf("\n");
+		}
+		std::fflush(stdout);
+	}
+}